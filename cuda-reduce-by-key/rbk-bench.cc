@@ -1,14 +1,23 @@
 #include <algorithm>
 #include <cassert>
 #include <functional>
+#include <memory>
 #include <random>
+#include <string>
 #include <vector>
 
 #include <cstdio>
 using std::printf;
 
+#include <omp.h>
+
 #include "benchmark/benchmark.h"
 
+#include "index-trace.h"
+#include "run-length-reduce.h"
+#include "segment-index.h"
+#include "segmented-reduce.h"
+
 struct indirect_example {
     std::vector<double> data;
     std::vector<double> inc;
@@ -53,6 +62,22 @@ indirect_example generate_example(std::size_t N, int min_width, int max_width, R
     return ex;
 }
 
+// Example with N data and N increments, with offsets drawn from
+// gen(offset_ptr, N, N, R) and optionally sorted.
+
+template <typename Gen, typename RNG>
+indirect_example generate_example_with(std::size_t N, Gen gen, bool sorted, RNG& R) {
+    std::uniform_real_distribution<double> UD(-1., 1.);
+
+    indirect_example ex(N, N);
+    std::generate(ex.data.begin(), ex.data.end(), [&]() { return UD(R); });
+    std::generate(ex.inc.begin(), ex.inc.end(), [&]() { return UD(R); });
+    gen(ex.offset.data(), N, N, R);
+    if (sorted) std::sort(ex.offset.begin(), ex.offset.end());
+
+    return ex;
+}
+
 using indirect_add_fn = std::function<float (indirect_example&, int)>;
 
 void check_indirect_add(indirect_example ex, indirect_add_fn op) {
@@ -70,11 +95,8 @@ void check_indirect_add(indirect_example ex, indirect_add_fn op) {
     }
 }
 
-void run_benchmark(benchmark::State& state, indirect_add_fn op, std::size_t N, int wl, int wh) {
+void run_benchmark(benchmark::State& state, indirect_add_fn op, indirect_example ex) {
     constexpr int reps = 5;
-    std::minstd_rand R;
-
-    auto ex = generate_example(N, wl, wh, R);
     check_indirect_add(ex, op);
 
     for (auto _: state) {
@@ -83,6 +105,11 @@ void run_benchmark(benchmark::State& state, indirect_add_fn op, std::size_t N, i
     }
 }
 
+void run_benchmark(benchmark::State& state, indirect_add_fn op, std::size_t N, int wl, int wh) {
+    std::minstd_rand R;
+    run_benchmark(state, op, generate_example(N, wl, wh, R));
+}
+
 float naive_reduce(indirect_example& ex, int reps) {
     std::size_t incsz = ex.inc.size();
 
@@ -116,6 +143,119 @@ float scalar_reduce(indirect_example& ex, int reps) {
     return 0;
 }
 
+float segmented_avx2_reduce(indirect_example& ex, int reps) {
+    for (int c = 0; c<reps; ++c) {
+        segmented_reduce_avx2(ex.inc.size(), ex.data.data(), ex.inc.data(), ex.offset.data());
+    }
+    return 0;
+}
+
+float segmented_avx512_reduce(indirect_example& ex, int reps) {
+    for (int c = 0; c<reps; ++c) {
+        segmented_reduce_avx512(ex.inc.size(), ex.data.data(), ex.inc.data(), ex.offset.data());
+    }
+    return 0;
+}
+
+float run_length_8_reduce(indirect_example& ex, int reps) {
+    for (int c = 0; c<reps; ++c) {
+        run_length_reduce_avx512_8(ex.inc.size(), ex.data.data(), ex.inc.data(), ex.offset.data());
+    }
+    return 0;
+}
+
+float run_length_16_reduce(indirect_example& ex, int reps) {
+    for (int c = 0; c<reps; ++c) {
+        run_length_reduce_avx512_16(ex.inc.size(), ex.data.data(), ex.inc.data(), ex.offset.data());
+    }
+    return 0;
+}
+
+// Reduction with a segment index built once from the offsets, outside
+// the timed loop; run_segment_index_build times the build alone. As with
+// the other implementations, each iteration of the former is five steps.
+
+void run_segment_index_benchmark(benchmark::State& state, indirect_example ex) {
+    auto s = std::make_shared<segment_index<int>>(ex.offset.data(), ex.offset.size());
+    state.counters["runs"] = s->runs();
+
+    run_benchmark(state,
+        [s](indirect_example& ex, int reps) {
+            for (int c = 0; c<reps; ++c) segment_index_reduce(*s, ex.data.data(), ex.inc.data());
+            return 0.f;
+        },
+        std::move(ex));
+}
+
+void run_segment_index_build(benchmark::State& state, indirect_example ex) {
+    for (auto _: state) {
+        segment_index<int> s(ex.offset.data(), ex.offset.size());
+        benchmark::DoNotOptimize(s.key.data());
+    }
+    state.counters["bytes"] = segment_index<int>(ex.offset.data(), ex.offset.size()).bytes();
+}
+
+// Multithreaded reduce-by-key: the updates are split into one contiguous
+// chunk per thread, and each chunk is reduced as in scalar_reduce. As
+// equal offsets are adjacent, only the first and last runs of a chunk can
+// be shared with other chunks (a long run may span several); their partial
+// sums are kept per thread and added serially after the parallel pass.
+
+float parallel_reduce(indirect_example& ex, int reps, int nthreads) {
+    std::size_t incsz = ex.inc.size();
+    if (!incsz) return 0;
+
+    double* p = ex.data.data();
+    const double* a = ex.inc.data();
+    const int* o = ex.offset.data();
+
+    struct boundary_runs {
+        int first_key, last_key;
+        double first_sum, last_sum;
+        bool single;
+    };
+    std::vector<boundary_runs> fixup(nthreads);
+
+    for (int c = 0; c<reps; ++c) {
+        #pragma omp parallel for num_threads(nthreads) schedule(static, 1)
+        for (int t = 0; t<nthreads; ++t) {
+            std::size_t b = incsz*t/nthreads, e = incsz*(t+1)/nthreads;
+            boundary_runs& f = fixup[t];
+
+            if (b==e) {
+                f = {o[0], o[0], 0., 0., true};
+                continue;
+            }
+
+            std::size_t i = b;
+            double acc = a[i];
+            while (i+1<e && o[i]==o[i+1]) acc += a[++i];
+            f.first_key = o[i];
+            f.first_sum = acc;
+            f.single = i+1==e;
+            if (f.single) continue;
+
+            acc = 0;
+            for (++i; i<e-1; ++i) {
+                acc += a[i];
+                if (o[i]!=o[i+1]) {
+                    p[o[i]] += acc;
+                    acc = 0;
+                }
+            }
+            f.last_key = o[e-1];
+            f.last_sum = acc+a[e-1];
+        }
+
+        for (auto& f: fixup) {
+            p[f.first_key] += f.first_sum;
+            if (!f.single) p[f.last_key] += f.last_sum;
+        }
+    }
+    return 0;
+}
+
+#ifndef RBK_CPU_ONLY
 extern float arbor_cuda_reduce_impl(std::size_t N, double* p, const double* v, const int* index, int reps);
 
 float arbor_cuda_reduce(indirect_example& ex, int reps) {
@@ -133,46 +273,158 @@ extern float expr2_cuda_reduce_impl(std::size_t N, double* p, const double* v, c
 float expr2_cuda_reduce(indirect_example& ex, int reps) {
     return expr2_cuda_reduce_impl(ex.inc.size(), ex.data.data(), ex.inc.data(), ex.offset.data(), reps);
 }
+#endif
 
 int main(int argc, char** argv) {
+    auto traces = take_trace_args(argc, argv);
+
+    // Implementations with monotonic_only set require equal offsets to be
+    // adjacent, and are not run on the blocked_sorted or trace cases.
     struct impl {
         std::string name;
         indirect_add_fn fn;
         bool manual_timing;
+        bool monotonic_only;
+        bool real_time = false;
     };
 
-    impl impls[] = {
-        {"naive", naive_reduce, false},
-        {"scalar", scalar_reduce, false},
-        {"arbor_cuda", arbor_cuda_reduce, true},
-        {"expr1_cuda", expr1_cuda_reduce, true},
-        {"expr2_cuda", expr2_cuda_reduce, true}
+    std::vector<impl> impls = {
+        {"naive", naive_reduce, false, false},
+        {"scalar", scalar_reduce, false, false},
+#ifndef RBK_CPU_ONLY
+        {"arbor_cuda", arbor_cuda_reduce, true, false},
+        {"expr1_cuda", expr1_cuda_reduce, true, false},
+        {"expr2_cuda", expr2_cuda_reduce, true, false}
+#endif
     };
 
+    // Multithreaded CPU reduction for 1, 2, 4, … up to the OpenMP maximum threads.
+    int max_threads = omp_get_max_threads();
+    for (int t = 1; ; t = std::min(2*t, max_threads)) {
+        impls.push_back({"parallel/threads:"+std::to_string(t),
+            [t](indirect_example& ex, int reps) { return parallel_reduce(ex, reps, t); }, false, true, true});
+        if (t==max_threads) break;
+    }
+
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        impls.push_back({"segmented_avx2", segmented_avx2_reduce, false, true});
+    }
+    if (__builtin_cpu_supports("avx512f")) {
+        impls.push_back({"segmented_avx512", segmented_avx512_reduce, false, true});
+    }
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512cd")) {
+        impls.push_back({"run_length_avx512_8", run_length_8_reduce, false, true});
+        impls.push_back({"run_length_avx512_16", run_length_16_reduce, false, true});
+    }
+
     std::size_t N = 1024007;
     double sparse = 0.1, dense = 10, very_dense = 100;
 
+    // Skewed and clustered run lengths from sorted synthetic offsets,
+    // at N and at a size well beyond LLC.
+    using offset_gen_fn = std::function<void (int*, std::size_t, std::size_t, std::minstd_rand&)>;
+    struct synthetic_case {
+        std::string name;
+        offset_gen_fn gen;
+        bool sorted;
+    };
+
+    synthetic_case synthetic[] = {
+        {"zipf", [](int* o, std::size_t n, std::size_t N, std::minstd_rand& R) {
+            zipf_offsets(o, n, N, 1.0, R); }, true},
+        {"clustered", [](int* o, std::size_t n, std::size_t N, std::minstd_rand& R) {
+            clustered_offsets(o, n, N, N/4096, 64., R); }, true},
+        {"blocked_sorted", [](int* o, std::size_t n, std::size_t N, std::minstd_rand& R) {
+            blocked_sorted_offsets(o, n, N, 4096, R); }, false}
+    };
+    std::size_t synthetic_N[] = {N, 1<<24};
+
+    // Fixed run width cases at N, with widths uniform in [wl, wh].
+    struct width_case {
+        std::string name;
+        int wl, wh;
+    };
+
+    width_case widths[] = {
+        {"constant", (int)N, (int)N},
+        {"distinct", 1, 1},
+        {"w1_5", 1, 5},
+        {"w15_60", 15, 60},
+        {"w123", 123, 123}
+    };
+
     for (auto& impl: impls) {
         std::vector<benchmark::internal::Benchmark*> benches;
 
-        benches.push_back(benchmark::RegisterBenchmark((impl.name+"/constant").c_str(),
-           [&](auto& st) { run_benchmark(st, impl.fn, N, N, N); }));
-        benches.push_back(benchmark::RegisterBenchmark((impl.name+"/distinct").c_str(),
-           [&](auto& st) { run_benchmark(st, impl.fn, N, 1, 1); }));
-        benches.push_back(benchmark::RegisterBenchmark((impl.name+"/w1_5").c_str(),
-           [&](auto& st) { run_benchmark(st, impl.fn, N, 1, 5); }));
-        benches.push_back(benchmark::RegisterBenchmark((impl.name+"/w15_60").c_str(),
-           [&](auto& st) { run_benchmark(st, impl.fn, N, 15, 60); }));
-        benches.push_back(benchmark::RegisterBenchmark((impl.name+"/w123").c_str(),
-           [&](auto& st) { run_benchmark(st, impl.fn, N, 123, 123); }));
+        for (auto& w: widths) {
+            benches.push_back(benchmark::RegisterBenchmark((impl.name+"/"+w.name).c_str(),
+               [&](auto& st) { run_benchmark(st, impl.fn, N, w.wl, w.wh); }));
+        }
+
+        for (auto& c: synthetic) {
+            if (impl.monotonic_only && !c.sorted) continue;
+
+            auto b = benchmark::RegisterBenchmark((impl.name+"/"+c.name).c_str(),
+               [&](auto& st) {
+                   std::minstd_rand R;
+                   run_benchmark(st, impl.fn, generate_example_with(st.range(0), c.gen, c.sorted, R));
+               });
+
+            b->ArgName("N");
+            for (auto n: synthetic_N) b->Arg(n);
+            benches.push_back(b);
+        }
+
+        for (auto& path: traces) {
+            if (impl.monotonic_only) break;
+            benches.push_back(benchmark::RegisterBenchmark((impl.name+"/trace:"+path.substr(path.find_last_of('/')+1)).c_str(),
+               [&](auto& st) { run_benchmark(st, impl.fn, load_trace_example<indirect_example>(path)); }));
+        }
 
         for (auto& b: benches) {
             if (impl.manual_timing) b->UseManualTime();
+            else if (impl.real_time) b->UseRealTime();
             b->ComputeStatistics("min", [](const std::vector<double>& v) -> double {
                 return *(std::min_element(std::begin(v), std::end(v)));
             });
         }
     }
+
+    // Cached segment index, for any offsets: per-step cost with the index
+    // built outside the timed loop, and the cost of one build.
+    using run_fn = std::function<void (benchmark::State&, indirect_example)>;
+    std::pair<std::string, run_fn> segment_runs[] = {
+        {"segment_index", run_segment_index_benchmark},
+        {"segment_index_build", run_segment_index_build}
+    };
+
+    for (auto& run: segment_runs) {
+        for (auto& w: widths) {
+            benchmark::RegisterBenchmark((run.first+"/"+w.name).c_str(),
+                [&](auto& st) {
+                    std::minstd_rand R;
+                    run.second(st, generate_example(N, w.wl, w.wh, R));
+                });
+        }
+
+        for (auto& c: synthetic) {
+            auto b = benchmark::RegisterBenchmark((run.first+"/"+c.name).c_str(),
+               [&](auto& st) {
+                   std::minstd_rand R;
+                   run.second(st, generate_example_with(st.range(0), c.gen, c.sorted, R));
+               });
+
+            b->ArgName("N");
+            for (auto n: synthetic_N) b->Arg(n);
+        }
+
+        for (auto& path: traces) {
+            benchmark::RegisterBenchmark((run.first+"/trace:"+path.substr(path.find_last_of('/')+1)).c_str(),
+               [&](auto& st) { run.second(st, load_trace_example<indirect_example>(path)); });
+        }
+    }
+
     benchmark::Initialize(&argc, argv);
     benchmark::RunSpecifiedBenchmarks();
 }
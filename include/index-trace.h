@@ -0,0 +1,298 @@
+#pragma once
+
+// Workloads for indirect addition p[o[i]] += v[i]: binary traces of
+// recorded offsets and values, and synthetic offset generators that
+// are more realistic than uniform random offsets.
+//
+// Trace file format (native byte order):
+//
+//     [0, 64)         trace_header, zero padded
+//     [64, ...)       count offsets, each index_size bytes (signed)
+//     [..., ...)      count values, each value_size bytes (float or double),
+//                     starting at the next multiple of 64 bytes.
+//
+// Traces are memory mapped, so that loading a trace is a copy (with any
+// type conversion) from the page cache, with no parsing.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct trace_header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t index_size;
+    std::uint32_t value_size;
+    std::uint32_t reserved;
+    std::uint64_t data_size;
+    std::uint64_t count;
+};
+
+constexpr char trace_magic[8] = {'I', 'D', 'X', 'T', 'R', 'A', 'C', 'E'};
+constexpr std::uint32_t trace_version = 1;
+constexpr std::size_t trace_align = 64;
+
+inline std::size_t trace_values_offset(const trace_header& h) {
+    std::size_t end = trace_align+h.count*h.index_size;
+    return (end+trace_align-1)/trace_align*trace_align;
+}
+
+struct mapped_trace {
+    trace_header header;
+    const char* base = nullptr;
+    std::size_t length = 0;
+
+    explicit mapped_trace(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd<0) throw std::system_error(errno, std::generic_category(), path);
+
+        struct stat st;
+        if (fstat(fd, &st)) {
+            int err = errno;
+            close(fd);
+            throw std::system_error(err, std::generic_category(), path);
+        }
+        length = st.st_size;
+        if (length<trace_align) {
+            close(fd);
+            throw std::runtime_error(path+": not a valid index trace");
+        }
+
+        void* p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        int err = errno;
+        close(fd);
+        if (p==MAP_FAILED) throw std::system_error(err, std::generic_category(), path);
+
+        base = static_cast<const char*>(p);
+        madvise(p, length, MADV_SEQUENTIAL);
+
+        std::memcpy(&header, base, sizeof(header));
+
+        if (std::memcmp(header.magic, trace_magic, sizeof(trace_magic)) ||
+            header.version!=trace_version ||
+            (header.index_size!=4 && header.index_size!=8) ||
+            (header.value_size!=4 && header.value_size!=8) ||
+            trace_values_offset(header)+header.count*header.value_size>length)
+        {
+            invalid(path);
+        }
+    }
+
+    mapped_trace(const mapped_trace&) = delete;
+    mapped_trace& operator=(const mapped_trace&) = delete;
+
+    ~mapped_trace() {
+        if (base) munmap((void*)base, length);
+    }
+
+    std::size_t data_size() const { return header.data_size; }
+    std::size_t count() const { return header.count; }
+
+    template <typename I>
+    void copy_offsets(I* out) const {
+        const char* p = base+trace_align;
+        if (header.index_size==4) copy_checked(reinterpret_cast<const std::int32_t*>(p), out);
+        else copy_checked(reinterpret_cast<const std::int64_t*>(p), out);
+    }
+
+    template <typename V>
+    void copy_values(V* out) const {
+        const char* p = base+trace_values_offset(header);
+        if (header.value_size==4) std::copy_n(reinterpret_cast<const float*>(p), count(), out);
+        else std::copy_n(reinterpret_cast<const double*>(p), count(), out);
+    }
+
+private:
+    void invalid(const std::string& path) {
+        munmap((void*)base, length);
+        base = nullptr;
+        throw std::runtime_error(path+": not a valid index trace");
+    }
+
+    template <typename J, typename I>
+    void copy_checked(const J* in, I* out) const {
+        std::size_t n = count();
+        for (std::size_t i = 0; i<n; ++i) {
+            if (in[i]<0 || std::uint64_t(in[i])>=header.data_size || J(I(in[i]))!=in[i]) {
+                throw std::range_error("index trace: offset out of range");
+            }
+            out[i] = I(in[i]);
+        }
+    }
+};
+
+template <typename I, typename V>
+void write_trace(const std::string& path, std::size_t data_size, const I* offsets, const V* values, std::size_t count) {
+    static_assert(sizeof(I)==4 || sizeof(I)==8, "unsupported index type");
+    static_assert(sizeof(V)==4 || sizeof(V)==8, "unsupported value type");
+
+    trace_header h = {};
+    std::memcpy(h.magic, trace_magic, sizeof(trace_magic));
+    h.version = trace_version;
+    h.index_size = sizeof(I);
+    h.value_size = sizeof(V);
+    h.data_size = data_size;
+    h.count = count;
+
+    std::ofstream out(path, std::ios::binary);
+    char zeros[trace_align] = {};
+
+    out.write((const char*)&h, sizeof(h));
+    out.write(zeros, trace_align-sizeof(h));
+    out.write((const char*)offsets, count*sizeof(I));
+    out.write(zeros, trace_values_offset(h)-trace_align-count*sizeof(I));
+    out.write((const char*)values, count*sizeof(V));
+
+    if (!out) throw std::runtime_error(path+": write failed");
+}
+
+// Load a trace into an example type with members data, offset, inc and
+// constructor Example(datasz, incsz).
+
+template <typename Example>
+Example load_trace_example(const std::string& path) {
+    mapped_trace t(path);
+
+    Example ex(t.data_size(), t.count());
+    t.copy_offsets(ex.offset.data());
+    t.copy_values(ex.inc.data());
+    return ex;
+}
+
+// Remove any --trace=PATH arguments from argv, returning the paths.
+
+inline std::vector<std::string> take_trace_args(int& argc, char** argv) {
+    const char prefix[] = "--trace=";
+    std::vector<std::string> paths;
+
+    int j = 1;
+    for (int i = 1; i<argc; ++i) {
+        if (!std::strncmp(argv[i], prefix, sizeof(prefix)-1)) {
+            paths.push_back(argv[i]+sizeof(prefix)-1);
+        }
+        else {
+            argv[j++] = argv[i];
+        }
+    }
+    argc = j;
+    return paths;
+}
+
+// Zipf distributed integers in [1, n] with exponent s > 0, by
+// rejection-inversion (Hörmann and Derflinger, 1996); O(1) setup and
+// memory for any n.
+
+class zipf_distribution {
+public:
+    zipf_distribution(std::uint64_t n, double s): n_(n), s_(s) {
+        h_x1_ = H(1.5)-1.;
+        h_n_ = H(n+0.5);
+        s0_ = 2.-H_inv(H(2.5)-h(2.));
+    }
+
+    template <typename Rng>
+    std::uint64_t operator()(Rng& R) {
+        std::uniform_real_distribution<double> U(0., 1.);
+        for (;;) {
+            double u = h_n_+U(R)*(h_x1_-h_n_);
+            double x = H_inv(u);
+
+            double k = std::floor(x+0.5);
+            if (k<1) k = 1;
+            else if (k>n_) k = n_;
+
+            if (k-x<=s0_ || u>=H(k+0.5)-h(k)) return std::uint64_t(k);
+        }
+    }
+
+private:
+    std::uint64_t n_;
+    double s_, h_x1_, h_n_, s0_;
+
+    // log1p(x)/x and expm1(x)/x, accurate near zero.
+    static double helper1(double x) {
+        return std::abs(x)>1e-8? std::log1p(x)/x: 1.-x*(0.5-x*(1./3.-0.25*x));
+    }
+
+    static double helper2(double x) {
+        return std::abs(x)>1e-8? std::expm1(x)/x: 1.+x*0.5*(1.+x/3.*(1.+0.25*x));
+    }
+
+    double h(double x) const { return std::exp(-s_*std::log(x)); }
+
+    double H(double x) const {
+        double lx = std::log(x);
+        return helper2((1.-s_)*lx)*lx;
+    }
+
+    double H_inv(double x) const {
+        double t = x*(1.-s_);
+        if (t<-1.) t = -1.;
+        return std::exp(helper1(t)*x);
+    }
+};
+
+// Zipf distributed offsets in [0, N): rank r is mapped to offset
+// (r-1)·m mod N for some m coprime to N, so that the popular offsets are
+// spread across the whole range.
+
+template <typename I, typename Rng>
+void zipf_offsets(I* o, std::size_t count, std::size_t N, double s, Rng& R) {
+    auto gcd = [](std::uint64_t a, std::uint64_t b) {
+        while (b) { auto r = a%b; a = b; b = r; }
+        return a;
+    };
+
+    std::uint64_t m = std::uint64_t(N*0.6180339887)|1;
+    while (gcd(m, N)!=1) m += 2;
+
+    zipf_distribution Z(N, s);
+    for (std::size_t i = 0; i<count; ++i) {
+        o[i] = I((unsigned __int128)(Z(R)-1)*m%N);
+    }
+}
+
+// Offsets drawn from n_clusters normal distributions of the given width
+// (standard deviation), with centres uniform in [0, N).
+
+template <typename I, typename Rng>
+void clustered_offsets(I* o, std::size_t count, std::size_t N, std::size_t n_clusters, double width, Rng& R) {
+    std::uniform_int_distribution<std::size_t> UC(0, N-1);
+    std::vector<std::size_t> centres(n_clusters);
+    std::generate(centres.begin(), centres.end(), [&]() { return UC(R); });
+
+    std::uniform_int_distribution<std::size_t> UK(0, n_clusters-1);
+    std::normal_distribution<double> G(0., width);
+
+    for (std::size_t i = 0; i<count; ++i) {
+        long long k = centres[UK(R)]+std::llround(G(R));
+        if (k<0) k = 0;
+        else if (k>=(long long)N) k = N-1;
+        o[i] = I(k);
+    }
+}
+
+// Uniform offsets in [0, N), sorted within consecutive blocks of
+// block_size updates (as from e.g. per-cell ordered mesh assembly).
+
+template <typename I, typename Rng>
+void blocked_sorted_offsets(I* o, std::size_t count, std::size_t N, std::size_t block_size, Rng& R) {
+    std::uniform_int_distribution<std::size_t> U(0, N-1);
+    for (std::size_t i = 0; i<count; ++i) o[i] = I(U(R));
+
+    for (std::size_t b = 0; b<count; b += block_size) {
+        std::sort(o+b, o+std::min(count, b+block_size));
+    }
+}
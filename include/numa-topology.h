@@ -0,0 +1,100 @@
+#pragma once
+
+// NUMA topology from sysfs, and page placement queries (move_pages), for
+// placement-aware benchmarks. Linux only; no libnuma dependency.
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Parse a sysfs list such as "0-3,8,10-11".
+
+inline std::vector<int> parse_id_list(std::istream& in) {
+    std::vector<int> ids;
+    long a = 0, b = 0;
+    char sep = 0;
+    while (in >> a) {
+        b = a;
+        if (in.peek()=='-') in >> sep >> b;
+        for (long k = a; k<=b; ++k) ids.push_back(k);
+        if (in.peek()==',') in >> sep;
+    }
+    return ids;
+}
+
+inline std::vector<int> parse_id_list(const std::string& path) {
+    std::ifstream f(path);
+    return parse_id_list(f);
+}
+
+// Online NUMA nodes; {0} if the system does not report any.
+
+inline std::vector<int> online_nodes() {
+    auto nodes = parse_id_list("/sys/devices/system/node/online");
+    if (nodes.empty()) nodes.push_back(0);
+    return nodes;
+}
+
+// CPUs of each online node (in online_nodes() order) that this process is
+// allowed to run on. Without sysfs node information, all allowed CPUs are
+// put on one node.
+
+inline std::vector<std::vector<int>> node_cpus() {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+
+    auto usable = [&](int c) { return c>=0 && c<CPU_SETSIZE && CPU_ISSET(c, &allowed); };
+
+    std::vector<std::vector<int>> cpus;
+    for (int node: online_nodes()) {
+        std::vector<int> list;
+        for (int c: parse_id_list("/sys/devices/system/node/node"+std::to_string(node)+"/cpulist")) {
+            if (usable(c)) list.push_back(c);
+        }
+        cpus.push_back(list);
+    }
+
+    bool any = false;
+    for (auto& list: cpus) any |= !list.empty();
+    if (!any) {
+        cpus.assign(1, {});
+        for (int c = 0; c<CPU_SETSIZE; ++c) {
+            if (usable(c)) cpus[0].push_back(c);
+        }
+    }
+    return cpus;
+}
+
+// Count resident pages of [p, p+size) by node, sampling every stride-th
+// page. The result is indexed by node id; pages not yet touched are not
+// counted. Returns an empty vector if placement cannot be queried.
+
+inline std::vector<std::size_t> page_nodes(const void* p, std::size_t size, std::size_t stride = 1) {
+    std::size_t page = sysconf(_SC_PAGESIZE);
+    std::size_t first = reinterpret_cast<std::size_t>(p)/page*page;
+    std::size_t end = reinterpret_cast<std::size_t>(p)+size;
+    stride = std::max<std::size_t>(stride, 1);
+
+    std::vector<void*> pages;
+    for (std::size_t a = first; a<end; a += stride*page) pages.push_back(reinterpret_cast<void*>(a));
+
+    std::vector<int> status(pages.size());
+    if (pages.empty() || syscall(SYS_move_pages, 0, pages.size(), pages.data(), nullptr, status.data(), 0)) {
+        return {};
+    }
+
+    std::vector<std::size_t> counts;
+    for (int s: status) {
+        if (s<0) continue;
+        if (std::size_t(s)>=counts.size()) counts.resize(s+1);
+        ++counts[s];
+    }
+    return counts;
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+// Custom allocator for aligned and padded allocation for SIMD implementations.
+// (Adapted from arbor source.)
+//
+// A memory_policy can additionally ask for the allocation to be backed by
+// 2 MiB pages, either transparent huge pages (madvise) or explicit huge
+// pages (MAP_HUGETLB, which requires pages to have been reserved), and for
+// NUMA placement by interleaving across all online nodes or binding to one
+// node (mbind). The default policy leaves placement to first touch.
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "numa-topology.h"
+
+enum class page_kind { normal, transparent_huge, explicit_huge };
+enum class numa_placement { first_touch, interleave, bind };
+
+struct memory_policy {
+    page_kind pages = page_kind::normal;
+    numa_placement numa = numa_placement::first_touch;
+    int node = 0;
+
+    bool operator==(const memory_policy& b) const {
+        return pages==b.pages && numa==b.numa && (numa!=numa_placement::bind || node==b.node);
+    }
+    bool operator!=(const memory_policy& b) const { return !(*this==b); }
+};
+
+inline std::string to_string(const memory_policy& mp) {
+    std::string s;
+    switch (mp.pages) {
+    case page_kind::normal: break;
+    case page_kind::transparent_huge: s = "thp"; break;
+    case page_kind::explicit_huge: s = "hugetlb"; break;
+    }
+    switch (mp.numa) {
+    case numa_placement::first_touch: break;
+    case numa_placement::interleave: s += s.empty()? "interleave": "+interleave"; break;
+    case numa_placement::bind: s += (s.empty()? "node": "+node")+std::to_string(mp.node); break;
+    }
+    return s.empty()? "default": s;
+}
+
+// Apply the NUMA placement of mp to the page-aligned range [p, p+size).
+
+inline void apply_numa_policy(void* p, std::size_t size, const memory_policy& mp) {
+    constexpr std::size_t mask_bits = 1024;
+    constexpr std::size_t word_bits = 8*sizeof(unsigned long);
+    unsigned long mask[mask_bits/word_bits] = {};
+
+    auto set_node = [&](long k) {
+        if (k>=0 && std::size_t(k)<mask_bits) mask[k/word_bits] |= 1ul<<(k%word_bits);
+    };
+
+    int mode;
+    if (mp.numa==numa_placement::bind) {
+        mode = MPOL_BIND;
+        set_node(mp.node);
+    }
+    else if (mp.numa==numa_placement::interleave) {
+        mode = MPOL_INTERLEAVE;
+        for (int k: online_nodes()) set_node(k);
+    }
+    else return;
+
+    if (syscall(SYS_mbind, p, size, mode, mask, mask_bits+1, 0)) {
+        throw std::system_error(errno, std::generic_category(), "mbind");
+    }
+}
+
+// Optional hook called with the size in bytes of every allocation made
+// through a padded_allocator, e.g. to count allocations in a benchmark.
+
+using padded_allocation_hook = void (*)(std::size_t);
+
+inline padded_allocation_hook& padded_allocation_hook_ref() {
+    static padded_allocation_hook hook = nullptr;
+    return hook;
+}
+
+template <typename T = void>
+struct padded_allocator {
+    static constexpr std::size_t alignment_ = 64;
+    static constexpr std::size_t huge_page_ = 2*1024*1024;
+
+    using value_type = T;
+    using pointer = T*;
+
+    memory_policy policy;
+
+    padded_allocator() noexcept {}
+
+    explicit padded_allocator(memory_policy policy) noexcept: policy(policy) {}
+
+    template <typename U>
+    padded_allocator(const padded_allocator<U>& b) noexcept: policy(b.policy) {}
+
+    pointer allocate(std::size_t n) {
+        if (n>std::size_t(-1)/sizeof(T)) {
+            throw std::bad_alloc();
+        }
+
+        void* mem = nullptr;
+        std::size_t size = allocated_size(n);
+
+        if (policy.pages==page_kind::explicit_huge) {
+            mem = mmap(nullptr, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+            if (mem==MAP_FAILED) {
+                throw std::system_error(errno, std::generic_category(), "mmap(MAP_HUGETLB)");
+            }
+        }
+        else {
+            std::size_t pm_align = std::max(alignment(), sizeof(void*));
+
+            if (auto err = posix_memalign(&mem, pm_align, size)) {
+                throw std::system_error(err, std::generic_category(), "posix_memalign");
+            }
+
+            // Advisory only: ignore failure if THP is unavailable.
+            if (policy.pages==page_kind::transparent_huge) madvise(mem, size, MADV_HUGEPAGE);
+        }
+
+        if (auto hook = padded_allocation_hook_ref()) hook(size);
+
+        try {
+            apply_numa_policy(mem, size, policy);
+        }
+        catch (...) {
+            deallocate(static_cast<pointer>(mem), n);
+            throw;
+        }
+        return static_cast<pointer>(mem);
+    }
+
+    void deallocate(pointer p, std::size_t n) {
+        if (policy.pages==page_kind::explicit_huge) {
+            munmap(p, allocated_size(n));
+        }
+        else {
+            std::free(p);
+        }
+    }
+
+    bool operator==(const padded_allocator& a) const { return policy==a.policy; }
+    bool operator!=(const padded_allocator& a) const { return policy!=a.policy; }
+
+private:
+    // Huge page policies use huge page alignment and size; NUMA placement
+    // requires at least page alignment and size.
+    std::size_t alignment() const {
+        if (policy.pages!=page_kind::normal) return huge_page_;
+        if (policy.numa!=numa_placement::first_touch) return std::max(std::size_t(alignment_), std::size_t(sysconf(_SC_PAGESIZE)));
+        return alignment_;
+    }
+
+    std::size_t allocated_size(std::size_t n) const {
+        return round_up(std::max<std::size_t>(n*sizeof(T), 1), alignment());
+    }
+
+    static std::size_t round_up(std::size_t v, std::size_t b) {
+         std::size_t m = v%b;
+         return v-m+(m? b: 0);
+    }
+};
+
+template <typename T>
+using padded_vector = std::vector<T, padded_allocator<T>>;
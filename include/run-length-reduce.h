@@ -0,0 +1,155 @@
+#pragma once
+
+// CPU port of the warp-level reduce-by-key in arb::reduce_impl (see
+// cuda-reduce-by-key/cuda-rbk.cu), with SIMD lanes in place of CUDA
+// threads, for p[o[i]] += v[i] where equal offsets are adjacent.
+//
+// As in arb::run_length, each lane finds the root (first lane) and right
+// bound of its run, and the largest power of two no greater than the run
+// length. The ballot of roots is a mask compare against the offsets
+// shifted by one lane; the run index of each lane is the popcount of the
+// roots at or below it, read for each byte of the root mask from a table
+// of prefix popcounts (the upper byte offset by a scalar popcount of the
+// lower), and the left and right bounds are looked up by
+// permuting the compressed root lanes. Each run is then summed into its
+// root lane with a tree of shifted adds, where the shuffles of the warp
+// are lane permutes, and the roots are written back with a gather and
+// scatter (in place of atomicAdd).
+//
+// Runs continuing across vectors are added once per vector, as they are
+// once per warp on the GPU. Within a vector the run roots must have
+// distinct offsets, so the offsets must be sorted (not just grouped in
+// blocks).
+//
+// The kernels are compiled with target attributes; callers must check
+// CPU support for AVX512F and AVX512CD before use.
+
+#include <cstddef>
+
+#include <immintrin.h>
+
+#define TARGET_RUN_LENGTH __attribute__((target("avx512f,avx512cd,popcnt")))
+
+// prefix[m][k]: popcount of the bits 0..k of the byte m.
+
+struct run_length_prefix_table {
+    alignas(64) unsigned char prefix[256][8];
+
+    constexpr run_length_prefix_table(): prefix{} {
+        for (unsigned m = 0; m<256; ++m) {
+            unsigned c = 0;
+            for (unsigned k = 0; k<8; ++k) {
+                c += (m>>k)&1;
+                prefix[m][k] = c;
+            }
+        }
+    }
+};
+
+inline const unsigned char* run_length_prefix(unsigned m) {
+    static constexpr run_length_prefix_table table{};
+    return table.prefix[m];
+}
+
+// Eight lanes: double values, with offsets widened to 64 bits.
+
+TARGET_RUN_LENGTH
+inline void run_length_reduce_avx512_8(std::size_t n, double* p, const double* v, const int* o) {
+    const __m512i lane = _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m512i one = _mm512_set1_epi64(1);
+    const __m512i top = _mm512_set1_epi64(63);
+
+    for (std::size_t i = 0; i<n; i+=8) {
+        __mmask8 active = n-i>=8? 0xff: (1u<<(n-i))-1;
+
+        __m256i o32 = _mm512_castsi512_si256(_mm512_maskz_loadu_epi32(active, o+i));
+        __m512i ok = _mm512_cvtepi32_epi64(o32);
+        __m512d x = _mm512_maskz_loadu_pd(active, v+i);
+
+        // Lanes past the end are roots of empty runs.
+        __mmask8 roots = _mm512_cmpneq_epi64_mask(ok, _mm512_alignr_epi64(ok, ok, 7)) | 1 | ~active;
+
+        __m128i count = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(run_length_prefix(roots)));
+        __m512i run = _mm512_sub_epi64(_mm512_cvtepu8_epi64(count), one);
+        __m512i starts = _mm512_maskz_compress_epi64(roots, lane);
+        __m512i ends = _mm512_mask_compress_epi64(_mm512_set1_epi64(8), roots&0xfe, lane);
+
+        __m512i left = _mm512_permutexvar_epi64(run, starts);
+        __m512i right = _mm512_permutexvar_epi64(run, ends);
+        __m512i key_lane = _mm512_sub_epi64(lane, left);
+
+        __m512i shift = _mm512_sllv_epi64(one, _mm512_sub_epi64(top, _mm512_lzcnt_epi64(_mm512_sub_epi64(right, left))));
+        __mmask8 participate = _mm512_cmplt_epi64_mask(_mm512_add_epi64(lane, shift), right);
+
+        while (_mm512_test_epi64_mask(shift, shift)) {
+            __m512i source = _mm512_mask_add_epi64(lane, participate, lane, shift);
+            x = _mm512_mask_add_pd(x, participate, x, _mm512_permutexvar_pd(source, x));
+
+            shift = _mm512_srli_epi64(shift, 1);
+            participate = _mm512_cmplt_epu64_mask(key_lane, shift);
+        }
+
+        __mmask8 write = roots&active;
+        __m512d y = _mm512_mask_i32gather_pd(_mm512_setzero_pd(), write, o32, p, sizeof(double));
+        _mm512_mask_i32scatter_pd(p, write, o32, _mm512_add_pd(x, y), sizeof(double));
+    }
+}
+
+// Sixteen lanes: run bounds and shifts on 32-bit lanes, with the double
+// values held in two vectors and permuted across both.
+
+TARGET_RUN_LENGTH
+inline void run_length_reduce_avx512_16(std::size_t n, double* p, const double* v, const int* o) {
+    const __m512i lane = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m512i one = _mm512_set1_epi32(1);
+    const __m512i top = _mm512_set1_epi32(31);
+
+    for (std::size_t i = 0; i<n; i+=16) {
+        __mmask16 active = n-i>=16? 0xffff: (1u<<(n-i))-1;
+
+        __m512i ok = _mm512_maskz_loadu_epi32(active, o+i);
+        __m512d x_lo = _mm512_maskz_loadu_pd(active, v+i);
+        __m512d x_hi = _mm512_maskz_loadu_pd(active>>8, v+i+8);
+
+        __mmask16 roots = _mm512_cmpneq_epi32_mask(ok, _mm512_alignr_epi32(ok, ok, 15)) | 1 | ~active;
+
+        __m128i count_lo = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(run_length_prefix(roots&0xff)));
+        __m128i count_hi = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(run_length_prefix(roots>>8)));
+        count_hi = _mm_add_epi8(count_hi, _mm_set1_epi8(char(_mm_popcnt_u32(roots&0xff))));
+        __m512i run = _mm512_sub_epi32(_mm512_cvtepu8_epi32(_mm_unpacklo_epi64(count_lo, count_hi)), one);
+        __m512i starts = _mm512_maskz_compress_epi32(roots, lane);
+        __m512i ends = _mm512_mask_compress_epi32(_mm512_set1_epi32(16), roots&0xfffe, lane);
+
+        __m512i left = _mm512_permutexvar_epi32(run, starts);
+        __m512i right = _mm512_permutexvar_epi32(run, ends);
+        __m512i key_lane = _mm512_sub_epi32(lane, left);
+
+        __m512i shift = _mm512_sllv_epi32(one, _mm512_sub_epi32(top, _mm512_lzcnt_epi32(_mm512_sub_epi32(right, left))));
+        __mmask16 participate = _mm512_cmplt_epi32_mask(_mm512_add_epi32(lane, shift), right);
+
+        while (_mm512_test_epi32_mask(shift, shift)) {
+            __m512i source = _mm512_mask_add_epi32(lane, participate, lane, shift);
+            __m512i source_lo = _mm512_cvtepi32_epi64(_mm512_castsi512_si256(source));
+            __m512i source_hi = _mm512_cvtepi32_epi64(_mm512_extracti64x4_epi64(source, 1));
+
+            __m512d s_lo = _mm512_permutex2var_pd(x_lo, source_lo, x_hi);
+            __m512d s_hi = _mm512_permutex2var_pd(x_lo, source_hi, x_hi);
+            x_lo = _mm512_mask_add_pd(x_lo, (__mmask8)participate, x_lo, s_lo);
+            x_hi = _mm512_mask_add_pd(x_hi, (__mmask8)(participate>>8), x_hi, s_hi);
+
+            shift = _mm512_srli_epi32(shift, 1);
+            participate = _mm512_cmplt_epu32_mask(key_lane, shift);
+        }
+
+        __mmask16 write = roots&active;
+        __m256i o_lo = _mm512_castsi512_si256(ok);
+        __m256i o_hi = _mm512_extracti64x4_epi64(ok, 1);
+
+        __m512d y_lo = _mm512_mask_i32gather_pd(_mm512_setzero_pd(), (__mmask8)write, o_lo, p, sizeof(double));
+        _mm512_mask_i32scatter_pd(p, (__mmask8)write, o_lo, _mm512_add_pd(x_lo, y_lo), sizeof(double));
+        __m512d y_hi = _mm512_mask_i32gather_pd(_mm512_setzero_pd(), (__mmask8)(write>>8), o_hi, p, sizeof(double));
+        _mm512_mask_i32scatter_pd(p, (__mmask8)(write>>8), o_hi, _mm512_add_pd(x_hi, y_hi), sizeof(double));
+    }
+}
+
+#undef TARGET_RUN_LENGTH
@@ -0,0 +1,58 @@
+#pragma once
+
+// Precomputed runs of equal offsets, for repeated p[o[i]] += v[i] with a
+// fixed offset pattern o (e.g. a mesh or network topology reused over
+// many time steps).
+//
+// The runs are held CSR style: run r covers updates [start[r], start[r+1])
+// and has offset key[r]. Building the index is one pass over the offsets;
+// each application is then a sum over each run and one update of p per
+// run, with no comparison of offsets.
+//
+// Offsets need not be sorted: an offset that occurs in several runs gets
+// one update per run, applied in order.
+
+#include <cstddef>
+#include <vector>
+
+template <typename I>
+struct segment_index {
+    std::vector<I> start;
+    std::vector<I> key;
+
+    segment_index() = default;
+
+    // Run starts are stored with the offset type: n must be representable in I.
+    segment_index(const I* o, std::size_t n) {
+        start.reserve(n+1);
+        key.reserve(n);
+
+        for (std::size_t i = 0; i<n; ++i) {
+            if (!i || o[i]!=o[i-1]) {
+                start.push_back(I(i));
+                key.push_back(o[i]);
+            }
+        }
+        start.push_back(I(n));
+
+        start.shrink_to_fit();
+        key.shrink_to_fit();
+    }
+
+    std::size_t runs() const { return key.size(); }
+
+    std::size_t bytes() const { return sizeof(I)*(start.size()+key.size()); }
+};
+
+template <typename V, typename I>
+void segment_index_reduce(const segment_index<I>& s, V* p, const V* v) {
+    std::size_t nruns = s.runs();
+    const I* start = s.start.data();
+    const I* key = s.key.data();
+
+    for (std::size_t r = 0; r<nruns; ++r) {
+        V acc = 0;
+        for (I j = start[r]; j<start[r+1]; ++j) acc += v[j];
+        p[key[r]] += acc;
+    }
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+// Vectorized reduce-by-key p[o[i]] += v[i], where equal offsets are
+// adjacent (e.g. the offsets are sorted).
+//
+// Run boundaries are found by comparing the offsets with the offsets
+// shifted by one lane, and each vector is reduced with a segmented
+// inclusive scan: at step s, lane k adds lane k-s if their offsets match.
+// As equal offsets are adjacent, this sums exactly the run prefix within
+// the vector. Only the last lane of each run is written back, and the
+// partial sum of a run which continues into the next vector is carried
+// into its first lane.
+//
+// The kernels are compiled with target attributes; callers must check
+// CPU support before use.
+
+#include <cstddef>
+
+#include <immintrin.h>
+
+__attribute__((target("avx2")))
+inline void segmented_reduce_avx2(std::size_t n, double* p, const double* v, const int* o) {
+    const __m256i lanes_ge1 = _mm256_setr_epi64x(0, -1, -1, -1);
+    const __m256i lanes_ge2 = _mm256_setr_epi64x(0, 0, -1, -1);
+
+    double carry = 0;
+    std::size_t i = 0;
+    for (; i+4<n; i+=4) {
+        __m256i ok = _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i*)(o+i)));
+        __m256i on = _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i*)(o+i+1)));
+        int end = ~_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(ok, on))) & 0xf;
+
+        __m256d x = _mm256_add_pd(_mm256_loadu_pd(v+i), _mm256_setr_pd(carry, 0, 0, 0));
+
+        __m256i m1 = _mm256_and_si256(lanes_ge1, _mm256_cmpeq_epi64(ok, _mm256_permute4x64_epi64(ok, _MM_SHUFFLE(2, 1, 0, 3))));
+        x = _mm256_add_pd(x, _mm256_and_pd(_mm256_castsi256_pd(m1), _mm256_permute4x64_pd(x, _MM_SHUFFLE(2, 1, 0, 3))));
+
+        __m256i m2 = _mm256_and_si256(lanes_ge2, _mm256_cmpeq_epi64(ok, _mm256_permute4x64_epi64(ok, _MM_SHUFFLE(1, 0, 3, 2))));
+        x = _mm256_add_pd(x, _mm256_and_pd(_mm256_castsi256_pd(m2), _mm256_permute4x64_pd(x, _MM_SHUFFLE(1, 0, 3, 2))));
+
+        alignas(32) double xx[4];
+        _mm256_store_pd(xx, x);
+
+        carry = end&8? 0: xx[3];
+        for (; end; end &= end-1) {
+            int k = __builtin_ctz(end);
+            p[o[i+k]] += xx[k];
+        }
+    }
+
+    double acc = carry;
+    for (; i<n; ++i) {
+        acc += v[i];
+        if (i+1==n || o[i]!=o[i+1]) {
+            p[o[i]] += acc;
+            acc = 0;
+        }
+    }
+}
+
+__attribute__((target("avx512f")))
+inline __m512d segmented_scan_avx512(__m512d x, __m512i ok) {
+    __mmask8 m1 = _mm512_mask_cmpeq_epi64_mask(0xfe, ok, _mm512_alignr_epi64(ok, ok, 7));
+    x = _mm512_mask_add_pd(x, m1, x, _mm512_castsi512_pd(_mm512_alignr_epi64(_mm512_castpd_si512(x), _mm512_castpd_si512(x), 7)));
+
+    __mmask8 m2 = _mm512_mask_cmpeq_epi64_mask(0xfc, ok, _mm512_alignr_epi64(ok, ok, 6));
+    x = _mm512_mask_add_pd(x, m2, x, _mm512_castsi512_pd(_mm512_alignr_epi64(_mm512_castpd_si512(x), _mm512_castpd_si512(x), 6)));
+
+    __mmask8 m4 = _mm512_mask_cmpeq_epi64_mask(0xf0, ok, _mm512_alignr_epi64(ok, ok, 4));
+    x = _mm512_mask_add_pd(x, m4, x, _mm512_castsi512_pd(_mm512_alignr_epi64(_mm512_castpd_si512(x), _mm512_castpd_si512(x), 4)));
+
+    return x;
+}
+
+__attribute__((target("avx512f")))
+inline void segmented_reduce_avx512(std::size_t n, double* p, const double* v, const int* o) {
+    if (!n) return;
+
+    const __m512i last = _mm512_set1_epi64(7);
+
+    double carry = 0;
+    std::size_t i = 0;
+    for (; i+8<n; i+=8) {
+        __m256i o32 = _mm256_loadu_si256((const __m256i*)(o+i));
+        __m512i ok = _mm512_cvtepi32_epi64(o32);
+        __m512i on = _mm512_cvtepi32_epi64(_mm256_loadu_si256((const __m256i*)(o+i+1)));
+        __mmask8 end = _mm512_cmpneq_epi64_mask(ok, on);
+
+        __m512d x = _mm512_loadu_pd(v+i);
+        x = _mm512_mask_add_pd(x, 1, x, _mm512_set1_pd(carry));
+        x = segmented_scan_avx512(x, ok);
+
+        carry = end&0x80? 0: _mm512_cvtsd_f64(_mm512_permutexvar_pd(last, x));
+        if (end) {
+            __m512d y = _mm512_mask_i32gather_pd(_mm512_setzero_pd(), end, o32, p, sizeof(double));
+            _mm512_mask_i32scatter_pd(p, end, o32, _mm512_add_pd(x, y), sizeof(double));
+        }
+    }
+
+    // Final 1 to 8 elements: the last active lane always ends a run.
+    unsigned rem = n-i;
+    __mmask8 active = (1u<<rem)-1;
+
+    __m256i o32 = _mm512_castsi512_si256(_mm512_maskz_loadu_epi32(active, o+i));
+    __m512i ok = _mm512_cvtepi32_epi64(o32);
+    __m512i on = _mm512_cvtepi32_epi64(_mm512_castsi512_si256(_mm512_maskz_loadu_epi32(active>>1, o+i+1)));
+    __mmask8 end = _mm512_mask_cmpneq_epi64_mask(active>>1, ok, on) | (1u<<(rem-1));
+
+    __m512d x = _mm512_maskz_loadu_pd(active, v+i);
+    x = _mm512_mask_add_pd(x, 1, x, _mm512_set1_pd(carry));
+    x = segmented_scan_avx512(x, ok);
+
+    __m512d y = _mm512_mask_i32gather_pd(_mm512_setzero_pd(), end, o32, p, sizeof(double));
+    _mm512_mask_i32scatter_pd(p, end, o32, _mm512_add_pd(x, y), sizeof(double));
+}
@@ -1,70 +1,40 @@
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <functional>
+#include <limits>
 #include <random>
 #include <memory>
+#include <numeric>
 #include <system_error>
+#include <type_traits>
 #include <vector>
 
 #include <iostream>
 
 #include <immintrin.h>
+#include <omp.h>
 
 #include "benchmark/benchmark.h"
 
-// Custom allocator for aligned and padded allocation for SIMD implementations.
-// (Adapted from arbor source.)
-
-template <typename T = void>
-struct padded_allocator {
-    static constexpr std::size_t alignment_ = 64;
-
-    using value_type = T;
-    using pointer = T*;
-
-    padded_allocator() noexcept {}
-
-    template <typename U>
-    padded_allocator(const padded_allocator<U>& b) noexcept {}
-
-    pointer allocate(std::size_t n) {
-        if (n>std::size_t(-1)/sizeof(T)) {
-            throw std::bad_alloc();
-        }
-
-        void* mem = nullptr;
-        std::size_t size = round_up(n*sizeof(T), alignment_);
-        std::size_t pm_align = std::max(alignment_, sizeof(void*));
-
-        if (auto err = posix_memalign(&mem, pm_align, size)) {
-            throw std::system_error(err, std::generic_category(), "posix_memalign");
-        }
-        return static_cast<pointer>(mem);
-    }
-
-    void deallocate(pointer p, std::size_t n) {
-        std::free(p);
-    }
-
-    bool operator==(const padded_allocator& a) const { return true; }
-    bool operator!=(const padded_allocator& a) const { return false; }
-
-private:
-    static std::size_t round_up(std::size_t v, std::size_t b) {
-         std::size_t m = v%b;
-         return v-m+(m? b: 0);
-    }
-};
-
-template <typename T>
-using padded_vector = std::vector<T, padded_allocator<T>>;
+#include "index-trace.h"
+#include "padded-allocator.h"
+#include "segment-index.h"
+#include "segmented-reduce.h"
 
+template <typename V = double, typename I = int>
 struct indirect_example {
-    padded_vector<double> data;
-    padded_vector<double> inc;
-    padded_vector<int> offset;
+    using value_type = V;
+    using index_type = I;
 
-    indirect_example(std::size_t datasz, std::size_t incsz):
-        data(datasz), inc(incsz), offset(incsz) {}
+    padded_vector<V> data;
+    padded_vector<V> inc;
+    padded_vector<I> offset;
+
+    indirect_example(std::size_t datasz, std::size_t incsz, memory_policy mp = {}):
+        data(datasz, padded_allocator<V>(mp)),
+        inc(incsz, padded_allocator<V>(mp)),
+        offset(incsz, padded_allocator<I>(mp)) {}
 
     // checked default indirect addition:
     void run() {
@@ -73,18 +43,18 @@ struct indirect_example {
         assert(offset.size()>=incsz);
 
         for (std::size_t i = 0; i<incsz; ++i) {
-            assert(offset[i]>=0 && offset[i]<datasz);
+            assert(offset[i]>=0 && std::size_t(offset[i])<datasz);
             data[offset[i]] += inc[i];
         }
     }
 };
 
-template <typename RNG>
-indirect_example generate_example(std::size_t N, double sparsity, bool monotonic, RNG& R) {
-    std::uniform_real_distribution<double> UD(-1., 1.);
-    std::uniform_int_distribution<int> UI(0,N-1);
+template <typename V, typename I, typename RNG>
+indirect_example<V, I> generate_example(std::size_t N, double sparsity, bool monotonic, RNG& R, memory_policy mp = {}) {
+    std::uniform_real_distribution<V> UD(-1., 1.);
+    std::uniform_int_distribution<I> UI(0,N-1);
 
-    indirect_example ex(N, N*sparsity);
+    indirect_example<V, I> ex(N, N*sparsity, mp);
     std::generate(ex.data.begin(), ex.data.end(), [&]() { return UD(R); });
     std::generate(ex.inc.begin(), ex.inc.end(), [&]() { return UD(R); });
     std::generate(ex.offset.begin(), ex.offset.end(), [&]() { return UI(R); });
@@ -93,33 +63,84 @@ indirect_example generate_example(std::size_t N, double sparsity, bool monotonic
     return ex;
 }
 
-using indirect_add_fn = std::function<void (indirect_example&)>;
-void check_indirect_add(indirect_example ex, indirect_add_fn op) {
-    // note: reordering of addition may make sum comparison inexact.
-    double epsilon = ex.data.size()*1e-14;
-    indirect_example ex_check = ex;
+// Example with N data and incsz increments, with offsets drawn from
+// gen(offset_ptr, incsz, N, R), e.g. one of the index-trace.h generators.
+
+template <typename V, typename I, typename Gen, typename RNG>
+indirect_example<V, I> generate_example_with(std::size_t N, std::size_t incsz, Gen gen, RNG& R) {
+    std::uniform_real_distribution<V> UD(-1., 1.);
+
+    indirect_example<V, I> ex(N, incsz);
+    std::generate(ex.data.begin(), ex.data.end(), [&]() { return UD(R); });
+    std::generate(ex.inc.begin(), ex.inc.end(), [&]() { return UD(R); });
+    gen(ex.offset.data(), incsz, N, R);
+
+    return ex;
+}
+
+template <typename V, typename I>
+using indirect_add_fn = std::function<void (indirect_example<V, I>&)>;
+
+template <typename V, typename I>
+void check_indirect_add(indirect_example<V, I> ex, indirect_add_fn<V, I> op) {
+    // note: reordering of addition may make sum comparison inexact. Any
+    // two orders of summing the m terms into one target differ by at most
+    // about (m-1)·eps·Σ|term|; allow twice that, per target.
+    std::vector<std::uint32_t> count(ex.data.size(), 1);
+    std::vector<double> magnitude(ex.data.size());
+    for (std::size_t i = 0; i<ex.data.size(); ++i) magnitude[i] = std::abs(double(ex.data[i]));
+    for (std::size_t i = 0; i<ex.inc.size(); ++i) {
+        ++count[ex.offset[i]];
+        magnitude[ex.offset[i]] += std::abs(double(ex.inc[i]));
+    }
+
+    indirect_example<V, I> ex_check = ex;
 
     ex_check.run();
     op(ex);
 
     assert(ex.data.size()==ex_check.data.size());
     for (std::size_t i = 0; i<ex.data.size(); ++i) {
-        assert(std::abs(ex.data[i]-ex_check.data[i])<=epsilon);
+        double epsilon = 2*count[i]*std::numeric_limits<V>::epsilon()*magnitude[i];
+        assert(std::abs(double(ex.data[i])-double(ex_check.data[i]))<=epsilon);
+        (void)epsilon;
     }
 }
 
-void run_benchmark(benchmark::State& state, indirect_add_fn op, std::size_t N, double sparsity, bool monotonic) {
-    std::minstd_rand R;
-
-    auto ex = generate_example(N, sparsity, monotonic, R);
+template <typename V, typename I>
+void run_benchmark(benchmark::State& state, indirect_add_fn<V, I> op, indirect_example<V, I> ex) {
     check_indirect_add(ex, op);
 
     for (auto _: state) {
         op(ex);
     }
+    state.SetItemsProcessed(state.iterations()*ex.inc.size());
+}
+
+// Indirect addition with a segment index built once from the offsets,
+// outside the timed loop; run_segment_index_build times the build alone.
+
+template <typename V, typename I>
+void run_segment_index_benchmark(benchmark::State& state, indirect_example<V, I> ex) {
+    auto s = std::make_shared<segment_index<I>>(ex.offset.data(), ex.inc.size());
+    state.counters["runs"] = s->runs();
+
+    run_benchmark<V, I>(state,
+        [s](indirect_example<V, I>& ex) { segment_index_reduce(*s, ex.data.data(), ex.inc.data()); },
+        std::move(ex));
+}
+
+template <typename V, typename I>
+void run_segment_index_build(benchmark::State& state, indirect_example<V, I> ex) {
+    for (auto _: state) {
+        segment_index<I> s(ex.offset.data(), ex.inc.size());
+        benchmark::DoNotOptimize(s.key.data());
+    }
+    state.counters["bytes"] = segment_index<I>(ex.offset.data(), ex.inc.size()).bytes();
 }
 
-void naive_impl(indirect_example& ex) {
+template <typename V, typename I>
+void naive_impl(indirect_example<V, I>& ex) {
     std::size_t incsz = ex.inc.size();
 
     for (std::size_t i = 0; i<incsz; ++i) {
@@ -127,14 +148,16 @@ void naive_impl(indirect_example& ex) {
     }
 }
 
-void scalar_impl(indirect_example& ex) {
+template <typename V, typename I>
+void scalar_impl(indirect_example<V, I>& ex) {
     std::size_t incsz = ex.inc.size();
+    if (!incsz) return;
 
-    double* p = ex.data.data();
-    const double* a = ex.inc.data();
-    const int* o = ex.offset.data();
+    V* p = ex.data.data();
+    const V* a = ex.inc.data();
+    const I* o = ex.offset.data();
 
-    double acc = 0;
+    V acc = 0;
     for (std::size_t i = 0; i<incsz-1; ++i) {
         acc += a[i];
         if (o[i]!=o[i+1]) {
@@ -146,19 +169,45 @@ void scalar_impl(indirect_example& ex) {
     p[o[incsz-1]] += acc;
 }
 
-#if defined(__AVX512F__)
-inline void addi_avx512(double* p, __m512i o, __m512d a) {
+// Kernels for instruction set extensions are compiled with per-function
+// target attributes, and registered at run time only if the CPU supports
+// them; the rest of the benchmark can then be built for a generic target.
+//
+// They are implemented only for particular value and index types: the
+// avx2_kernel and avx512_kernel functions return an empty function for
+// unsupported combinations.
+
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx512f,avx512cd")))
+
+template <typename V, typename I> void avx2_impl(indirect_example<V, I>&);
+template <typename V, typename I> void avx512_impl(indirect_example<V, I>&);
+
+template <typename V, typename I>
+indirect_add_fn<V, I> avx2_kernel() { return {}; }
+
+template <typename V, typename I>
+indirect_add_fn<V, I> avx512_kernel() { return {}; }
+
+// AVX512: the conflict mask for each lane gives the earlier lanes with the
+// same offset. Each lane accumulates the increments of the later lanes that
+// name it in their conflict mask, and only the first lane for each offset
+// is written back. Lanes outside the mask m are neither gathered nor
+// scattered, and contribute zero increments.
+
+TARGET_AVX512
+inline void addi_avx512(double* p, __m512i o, __m512d a, __mmask8 m) {
     __m512i confv = _mm512_conflict_epi32(o);
 
-    int conf[8];
-    _mm256_storeu_si256((__m256i*)conf, _mm512_castsi512_si256(confv));
+    int conf[16];
+    _mm512_storeu_si512((void*)conf, confv);
 
     double aa[8];
-    _mm512_storeu_pd((__m512d*)aa, a);
+    _mm512_storeu_pd((void*)aa, a);
 
-    __mmask16 wmask = _mm512_cmpeq_epi32_mask(confv, _mm512_setzero_epi32());
+    __mmask8 wmask = m & (__mmask8)_mm512_cmpeq_epi32_mask(confv, _mm512_setzero_epi32());
 
-    __m512d x = _mm512_i32gather_pd(_mm512_castsi512_si256(o), (const void*)p, sizeof(double));
+    __m512d x = _mm512_mask_i32gather_pd(_mm512_setzero_pd(), m, _mm512_castsi512_si256(o), (const void*)p, sizeof(double));
 
     __m512d p01 = _mm512_add_pd(
                         _mm512_maskz_broadcastsd_pd(_mm512_int2mask(conf[0]), _mm_set1_pd(aa[0])),
@@ -187,53 +236,999 @@ inline void addi_avx512(double* p, __m512i o, __m512d a) {
     _mm512_mask_i32scatter_pd((void*)p, wmask, _mm512_castsi512_si256(o), x, sizeof(double));
 }
 
-void avx512_impl(indirect_example& ex) {
+TARGET_AVX512
+inline void addi_avx512_i64(double* p, __m512i o, __m512d a, __mmask8 m) {
+    __m512i confv = _mm512_conflict_epi64(o);
+
+    long long conf[8];
+    _mm512_storeu_si512((void*)conf, confv);
+
+    double aa[8];
+    _mm512_storeu_pd((void*)aa, a);
+
+    __mmask8 wmask = m & _mm512_cmpeq_epi64_mask(confv, _mm512_setzero_si512());
+
+    __m512d x = _mm512_mask_i64gather_pd(_mm512_setzero_pd(), m, o, (const void*)p, sizeof(double));
+
+    __m512d p01 = _mm512_add_pd(
+                        _mm512_maskz_broadcastsd_pd((__mmask8)conf[0], _mm_set1_pd(aa[0])),
+                        _mm512_maskz_broadcastsd_pd((__mmask8)conf[1], _mm_set1_pd(aa[1])));
+
+    __m512d p23 = _mm512_add_pd(
+                        _mm512_maskz_broadcastsd_pd((__mmask8)conf[2], _mm_set1_pd(aa[2])),
+                        _mm512_maskz_broadcastsd_pd((__mmask8)conf[3], _mm_set1_pd(aa[3])));
+
+    __m512d p45 = _mm512_add_pd(
+                        _mm512_maskz_broadcastsd_pd((__mmask8)conf[4], _mm_set1_pd(aa[4])),
+                        _mm512_maskz_broadcastsd_pd((__mmask8)conf[5], _mm_set1_pd(aa[5])));
+
+    __m512d p67 = _mm512_add_pd(
+                        _mm512_maskz_broadcastsd_pd((__mmask8)conf[6], _mm_set1_pd(aa[6])),
+                        _mm512_maskz_broadcastsd_pd((__mmask8)conf[7], _mm_set1_pd(aa[7])));
+
+    x = _mm512_add_pd(
+            _mm512_add_pd(x, a),
+            _mm512_add_pd(
+                _mm512_add_pd(p01, p23),
+                _mm512_add_pd(p45, p67)
+            )
+        );
+
+    _mm512_mask_i64scatter_pd((void*)p, wmask, o, x, sizeof(double));
+}
+
+// Single precision values with 32-bit offsets use all 16 lanes.
+
+TARGET_AVX512
+inline void addi_avx512(float* p, __m512i o, __m512 a, __mmask16 m) {
+    __m512i confv = _mm512_conflict_epi32(o);
+
+    int conf[16];
+    _mm512_storeu_si512((void*)conf, confv);
+
+    float aa[16];
+    _mm512_storeu_ps((void*)aa, a);
+
+    __mmask16 wmask = m & _mm512_cmpeq_epi32_mask(confv, _mm512_setzero_epi32());
+
+    __m512 x = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), m, o, (const void*)p, sizeof(float));
+
+    __m512 s[4] = {a, _mm512_setzero_ps(), _mm512_setzero_ps(), _mm512_setzero_ps()};
+    for (int k = 0; k<16; ++k) {
+        s[k%4] = _mm512_add_ps(s[k%4], _mm512_maskz_broadcastss_ps(_mm512_int2mask(conf[k]), _mm_set1_ps(aa[k])));
+    }
+
+    x = _mm512_add_ps(
+            _mm512_add_ps(x, _mm512_add_ps(s[0], s[1])),
+            _mm512_add_ps(s[2], s[3])
+        );
+
+    _mm512_mask_i32scatter_ps((void*)p, wmask, o, x, sizeof(float));
+}
+
+template <>
+TARGET_AVX512
+void avx512_impl(indirect_example<double, int>& ex) {
     std::size_t incsz = ex.inc.size();
-    assert(incsz%8==0);
 
     double* p = ex.data.data();
     double* inc = ex.inc.data();
     int* off = ex.offset.data();
 
     __mmask16 lo = _cvtu32_mask16(0xffu);
-    for (std::size_t i = 0; i<incsz; i+=8) {
+    std::size_t i = 0;
+    for (; i+8<=incsz; i+=8) {
         __m512d a = _mm512_load_pd((void*)inc);
         __m512i o = _mm512_maskz_loadu_epi32(lo, (void*)off);
 
-        addi_avx512(p, o, a);
+        addi_avx512(p, o, a, 0xff);
 
         inc += 8;
         off += 8;
     }
+    if (i<incsz) {
+        __mmask8 m = (1u<<(incsz-i))-1;
+        __m512d a = _mm512_maskz_loadu_pd(m, (void*)inc);
+        __m512i o = _mm512_maskz_loadu_epi32(m, (void*)off);
+
+        addi_avx512(p, o, a, m);
+    }
 }
-#endif
 
-int main(int argc, char** argv) {
-    std::vector<std::pair<std::string, indirect_add_fn>> impls = {
-        {"naive", naive_impl},
-        {"scalar", scalar_impl}
+template <>
+TARGET_AVX512
+void avx512_impl(indirect_example<double, std::int64_t>& ex) {
+    std::size_t incsz = ex.inc.size();
+
+    double* p = ex.data.data();
+    double* inc = ex.inc.data();
+    std::int64_t* off = ex.offset.data();
+
+    std::size_t i = 0;
+    for (; i+8<=incsz; i+=8) {
+        __m512d a = _mm512_load_pd((void*)inc);
+        __m512i o = _mm512_load_si512((void*)off);
+
+        addi_avx512_i64(p, o, a, 0xff);
+
+        inc += 8;
+        off += 8;
+    }
+    if (i<incsz) {
+        __mmask8 m = (1u<<(incsz-i))-1;
+        __m512d a = _mm512_maskz_loadu_pd(m, (void*)inc);
+        __m512i o = _mm512_maskz_loadu_epi64(m, (void*)off);
+
+        addi_avx512_i64(p, o, a, m);
+    }
+}
+
+template <>
+TARGET_AVX512
+void avx512_impl(indirect_example<float, int>& ex) {
+    std::size_t incsz = ex.inc.size();
+
+    float* p = ex.data.data();
+    float* inc = ex.inc.data();
+    int* off = ex.offset.data();
+
+    std::size_t i = 0;
+    for (; i+16<=incsz; i+=16) {
+        __m512 a = _mm512_load_ps((void*)inc);
+        __m512i o = _mm512_load_si512((void*)off);
+
+        addi_avx512(p, o, a, 0xffff);
+
+        inc += 16;
+        off += 16;
+    }
+    if (i<incsz) {
+        __mmask16 m = (1u<<(incsz-i))-1;
+        __m512 a = _mm512_maskz_loadu_ps(m, (void*)inc);
+        __m512i o = _mm512_maskz_loadu_epi32(m, (void*)off);
+
+        addi_avx512(p, o, a, m);
+    }
+}
+
+template <> indirect_add_fn<double, int> avx512_kernel() { return avx512_impl<double, int>; }
+template <> indirect_add_fn<double, std::int64_t> avx512_kernel() { return avx512_impl<double, std::int64_t>; }
+template <> indirect_add_fn<float, int> avx512_kernel() { return avx512_impl<float, int>; }
+
+// AVX2: without a conflict detection instruction, compare the offsets
+// against each of their rotations. Every lane then accumulates the
+// increments of all lanes that share its offset, so that each lane in a
+// run of duplicates holds the same (up to rounding) updated value, and the
+// scalar stores can be performed in any order.
+
+TARGET_AVX2
+inline void addi_avx2(double* p, __m128i o, __m256d a) {
+    __m128i o1 = _mm_shuffle_epi32(o, _MM_SHUFFLE(0, 3, 2, 1));
+    __m128i o2 = _mm_shuffle_epi32(o, _MM_SHUFFLE(1, 0, 3, 2));
+    __m128i o3 = _mm_shuffle_epi32(o, _MM_SHUFFLE(2, 1, 0, 3));
+
+    __m128i eq1 = _mm_cmpeq_epi32(o, o1);
+    __m128i eq2 = _mm_cmpeq_epi32(o, o2);
+    __m128i eq3 = _mm_cmpeq_epi32(o, o3);
+
+    __m256d x = _mm256_i32gather_pd(p, o, sizeof(double));
+    x = _mm256_add_pd(x, a);
+
+    if (!_mm_testz_si128(_mm_or_si128(eq1, _mm_or_si128(eq2, eq3)), _mm_set1_epi32(-1))) {
+        __m256d a1 = _mm256_permute4x64_pd(a, _MM_SHUFFLE(0, 3, 2, 1));
+        __m256d a2 = _mm256_permute4x64_pd(a, _MM_SHUFFLE(1, 0, 3, 2));
+        __m256d a3 = _mm256_permute4x64_pd(a, _MM_SHUFFLE(2, 1, 0, 3));
+
+        __m256d c1 = _mm256_and_pd(a1, _mm256_castsi256_pd(_mm256_cvtepi32_epi64(eq1)));
+        __m256d c2 = _mm256_and_pd(a2, _mm256_castsi256_pd(_mm256_cvtepi32_epi64(eq2)));
+        __m256d c3 = _mm256_and_pd(a3, _mm256_castsi256_pd(_mm256_cvtepi32_epi64(eq3)));
+
+        x = _mm256_add_pd(x, _mm256_add_pd(c1, _mm256_add_pd(c2, c3)));
+    }
+
+    alignas(32) double xx[4];
+    alignas(16) int oo[4];
+    _mm256_store_pd(xx, x);
+    _mm_store_si128((__m128i*)oo, o);
+
+    p[oo[0]] = xx[0];
+    p[oo[1]] = xx[1];
+    p[oo[2]] = xx[2];
+    p[oo[3]] = xx[3];
+}
+
+TARGET_AVX2
+inline void addi_avx2(double* p, __m256i o, __m256d a) {
+    __m256i o1 = _mm256_permute4x64_epi64(o, _MM_SHUFFLE(0, 3, 2, 1));
+    __m256i o2 = _mm256_permute4x64_epi64(o, _MM_SHUFFLE(1, 0, 3, 2));
+    __m256i o3 = _mm256_permute4x64_epi64(o, _MM_SHUFFLE(2, 1, 0, 3));
+
+    __m256i eq1 = _mm256_cmpeq_epi64(o, o1);
+    __m256i eq2 = _mm256_cmpeq_epi64(o, o2);
+    __m256i eq3 = _mm256_cmpeq_epi64(o, o3);
+
+    __m256d x = _mm256_i64gather_pd(p, o, sizeof(double));
+    x = _mm256_add_pd(x, a);
+
+    if (!_mm256_testz_si256(_mm256_or_si256(eq1, _mm256_or_si256(eq2, eq3)), _mm256_set1_epi32(-1))) {
+        __m256d a1 = _mm256_permute4x64_pd(a, _MM_SHUFFLE(0, 3, 2, 1));
+        __m256d a2 = _mm256_permute4x64_pd(a, _MM_SHUFFLE(1, 0, 3, 2));
+        __m256d a3 = _mm256_permute4x64_pd(a, _MM_SHUFFLE(2, 1, 0, 3));
+
+        __m256d c1 = _mm256_and_pd(a1, _mm256_castsi256_pd(eq1));
+        __m256d c2 = _mm256_and_pd(a2, _mm256_castsi256_pd(eq2));
+        __m256d c3 = _mm256_and_pd(a3, _mm256_castsi256_pd(eq3));
+
+        x = _mm256_add_pd(x, _mm256_add_pd(c1, _mm256_add_pd(c2, c3)));
+    }
+
+    alignas(32) double xx[4];
+    alignas(32) long long oo[4];
+    _mm256_store_pd(xx, x);
+    _mm256_store_si256((__m256i*)oo, o);
+
+    p[oo[0]] = xx[0];
+    p[oo[1]] = xx[1];
+    p[oo[2]] = xx[2];
+    p[oo[3]] = xx[3];
+}
+
+// Eight single precision lanes: rotate one lane at a time through all
+// seven non-trivial rotations.
+
+TARGET_AVX2
+inline void addi_avx2(float* p, __m256i o, __m256 a) {
+    const __m256i rot = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
+
+    __m256 x = _mm256_i32gather_ps(p, o, sizeof(float));
+    x = _mm256_add_ps(x, a);
+
+    __m256i ok = o;
+    __m256 ak = a;
+    __m256 c = _mm256_setzero_ps();
+    for (int k = 1; k<8; ++k) {
+        ok = _mm256_permutevar8x32_epi32(ok, rot);
+        ak = _mm256_permutevar8x32_ps(ak, rot);
+        c = _mm256_add_ps(c, _mm256_and_ps(ak, _mm256_castsi256_ps(_mm256_cmpeq_epi32(o, ok))));
+    }
+    x = _mm256_add_ps(x, c);
+
+    alignas(32) float xx[8];
+    alignas(32) int oo[8];
+    _mm256_store_ps(xx, x);
+    _mm256_store_si256((__m256i*)oo, o);
+
+    for (int k = 0; k<8; ++k) p[oo[k]] = xx[k];
+}
+
+template <>
+TARGET_AVX2
+void avx2_impl(indirect_example<double, int>& ex) {
+    std::size_t incsz = ex.inc.size();
+
+    double* p = ex.data.data();
+    const double* inc = ex.inc.data();
+    const int* off = ex.offset.data();
+
+    std::size_t i = 0;
+    for (; i+4<=incsz; i+=4) {
+        __m256d a = _mm256_loadu_pd(inc+i);
+        __m128i o = _mm_loadu_si128((const __m128i*)(off+i));
+
+        addi_avx2(p, o, a);
+    }
+    for (; i<incsz; ++i) {
+        p[off[i]] += inc[i];
+    }
+}
+
+template <>
+TARGET_AVX2
+void avx2_impl(indirect_example<double, std::int64_t>& ex) {
+    std::size_t incsz = ex.inc.size();
+
+    double* p = ex.data.data();
+    const double* inc = ex.inc.data();
+    const std::int64_t* off = ex.offset.data();
+
+    std::size_t i = 0;
+    for (; i+4<=incsz; i+=4) {
+        __m256d a = _mm256_loadu_pd(inc+i);
+        __m256i o = _mm256_loadu_si256((const __m256i*)(off+i));
+
+        addi_avx2(p, o, a);
+    }
+    for (; i<incsz; ++i) {
+        p[off[i]] += inc[i];
+    }
+}
+
+template <>
+TARGET_AVX2
+void avx2_impl(indirect_example<float, int>& ex) {
+    std::size_t incsz = ex.inc.size();
+
+    float* p = ex.data.data();
+    const float* inc = ex.inc.data();
+    const int* off = ex.offset.data();
+
+    std::size_t i = 0;
+    for (; i+8<=incsz; i+=8) {
+        __m256 a = _mm256_loadu_ps(inc+i);
+        __m256i o = _mm256_loadu_si256((const __m256i*)(off+i));
+
+        addi_avx2(p, o, a);
+    }
+    for (; i<incsz; ++i) {
+        p[off[i]] += inc[i];
+    }
+}
+
+template <> indirect_add_fn<double, int> avx2_kernel() { return avx2_impl<double, int>; }
+template <> indirect_add_fn<double, std::int64_t> avx2_kernel() { return avx2_impl<double, std::int64_t>; }
+template <> indirect_add_fn<float, int> avx2_kernel() { return avx2_impl<float, int>; }
+
+// Segmented reduction kernels for monotonic offsets (see segmented-reduce.h),
+// for double values and 32-bit offsets.
+
+template <typename V, typename I>
+indirect_add_fn<V, I> segmented_avx2_kernel() { return {}; }
+
+template <typename V, typename I>
+indirect_add_fn<V, I> segmented_avx512_kernel() { return {}; }
+
+template <>
+indirect_add_fn<double, int> segmented_avx2_kernel() {
+    return [](indirect_example<double, int>& ex) {
+        segmented_reduce_avx2(ex.inc.size(), ex.data.data(), ex.inc.data(), ex.offset.data());
+    };
+}
+
+template <>
+indirect_add_fn<double, int> segmented_avx512_kernel() {
+    return [](indirect_example<double, int>& ex) {
+        segmented_reduce_avx512(ex.inc.size(), ex.data.data(), ex.inc.data(), ex.offset.data());
+    };
+}
+
+// Conflict-free scheduling: a one-time pass over a fixed offset array
+// reorders the updates into batches of width lanes with distinct offsets,
+// by greedy first-fit colouring. Each update goes to the first batch with
+// a free lane after the last batch holding its offset; the next batch with
+// a free lane is found with a path-compressed forwarding array. Each step
+// is then a plain gather-add-scatter per batch, with the increments
+// gathered through the permutation, and no conflict detection.
+//
+// Updates to the same offset keep their relative order. Batches are mostly
+// full unless a few offsets account for a large fraction of the updates:
+// the number of batches is at least the greatest multiplicity of any offset.
+
+template <typename I>
+struct conflict_free_schedule {
+    unsigned width;
+    padded_vector<I> perm;      // update index of each lane
+    padded_vector<I> offset;    // offset of each lane
+    std::vector<std::uint16_t> mask; // occupied lanes of each batch
+
+    conflict_free_schedule(const I* o, std::size_t n, std::size_t datasz, unsigned width): width(width) {
+        std::vector<std::size_t> after(datasz, 0);  // first batch allowed for each offset
+        std::vector<std::size_t> next;              // forwarding to the next batch with a free lane
+        std::vector<unsigned> fill;
+        std::vector<std::size_t> batch(n);
+        std::vector<unsigned> lane(n);
+
+        auto free_batch = [&](std::size_t b) {
+            std::size_t r = b;
+            while (r<next.size() && next[r]!=r) r = next[r];
+            if (r==next.size()) {
+                next.push_back(r);
+                fill.push_back(0);
+            }
+            while (b<next.size() && b!=r) {
+                std::size_t t = next[b];
+                next[b] = r;
+                b = t;
+            }
+            return r;
+        };
+
+        for (std::size_t i = 0; i<n; ++i) {
+            std::size_t b = free_batch(after[o[i]]);
+            batch[i] = b;
+            lane[i] = fill[b]++;
+            if (fill[b]==width) next[b] = b+1;
+            after[o[i]] = b+1;
+        }
+
+        std::size_t nbatch = fill.size();
+        perm.assign(nbatch*width, 0);
+        offset.assign(nbatch*width, 0);
+        mask.assign(nbatch, 0);
+
+        for (std::size_t i = 0; i<n; ++i) {
+            std::size_t k = batch[i]*width+lane[i];
+            perm[k] = I(i);
+            offset[k] = o[i];
+            mask[batch[i]] |= 1u<<lane[i];
+        }
+    }
+
+    std::size_t batches() const { return mask.size(); }
+
+    std::size_t bytes() const {
+        return sizeof(I)*(perm.size()+offset.size())+sizeof(std::uint16_t)*mask.size();
+    }
+};
+
+// Batch width per value and index type; zero where there is no kernel.
+
+template <typename V, typename I>
+constexpr unsigned conflict_free_width() { return 0; }
+
+template <> constexpr unsigned conflict_free_width<double, int>() { return 8; }
+template <> constexpr unsigned conflict_free_width<double, std::int64_t>() { return 8; }
+template <> constexpr unsigned conflict_free_width<float, int>() { return 16; }
+
+template <typename V, typename I>
+void conflict_free_apply(const conflict_free_schedule<I>&, indirect_example<V, I>&);
+
+template <>
+TARGET_AVX512
+void conflict_free_apply(const conflict_free_schedule<int>& s, indirect_example<double, int>& ex) {
+    double* p = ex.data.data();
+    const double* inc = ex.inc.data();
+    const int* perm = s.perm.data();
+    const int* off = s.offset.data();
+
+    for (std::size_t b = 0; b<s.batches(); ++b) {
+        __mmask8 m = s.mask[b];
+        __m256i j = _mm256_load_si256((const __m256i*)(perm+8*b));
+        __m256i o = _mm256_load_si256((const __m256i*)(off+8*b));
+
+        __m512d a = _mm512_mask_i32gather_pd(_mm512_setzero_pd(), m, j, inc, sizeof(double));
+        __m512d x = _mm512_mask_i32gather_pd(_mm512_setzero_pd(), m, o, p, sizeof(double));
+        _mm512_mask_i32scatter_pd(p, m, o, _mm512_add_pd(x, a), sizeof(double));
+    }
+}
+
+template <>
+TARGET_AVX512
+void conflict_free_apply(const conflict_free_schedule<std::int64_t>& s, indirect_example<double, std::int64_t>& ex) {
+    double* p = ex.data.data();
+    const double* inc = ex.inc.data();
+    const std::int64_t* perm = s.perm.data();
+    const std::int64_t* off = s.offset.data();
+
+    for (std::size_t b = 0; b<s.batches(); ++b) {
+        __mmask8 m = s.mask[b];
+        __m512i j = _mm512_load_si512((const void*)(perm+8*b));
+        __m512i o = _mm512_load_si512((const void*)(off+8*b));
+
+        __m512d a = _mm512_mask_i64gather_pd(_mm512_setzero_pd(), m, j, inc, sizeof(double));
+        __m512d x = _mm512_mask_i64gather_pd(_mm512_setzero_pd(), m, o, p, sizeof(double));
+        _mm512_mask_i64scatter_pd(p, m, o, _mm512_add_pd(x, a), sizeof(double));
+    }
+}
+
+template <>
+TARGET_AVX512
+void conflict_free_apply(const conflict_free_schedule<int>& s, indirect_example<float, int>& ex) {
+    float* p = ex.data.data();
+    const float* inc = ex.inc.data();
+    const int* perm = s.perm.data();
+    const int* off = s.offset.data();
+
+    for (std::size_t b = 0; b<s.batches(); ++b) {
+        __mmask16 m = s.mask[b];
+        __m512i j = _mm512_load_si512((const void*)(perm+16*b));
+        __m512i o = _mm512_load_si512((const void*)(off+16*b));
+
+        __m512 a = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), m, j, inc, sizeof(float));
+        __m512 x = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), m, o, p, sizeof(float));
+        _mm512_mask_i32scatter_ps(p, m, o, _mm512_add_ps(x, a), sizeof(float));
+    }
+}
+
+// Schedule built outside the timed loop; the 'fill' counter is the
+// fraction of occupied lanes. run_conflict_free_build times the build
+// alone, with the schedule size relative to the offset array in 'overhead'.
+
+template <typename V, typename I>
+void run_conflict_free_benchmark(benchmark::State& state, indirect_example<V, I> ex) {
+    constexpr unsigned width = conflict_free_width<V, I>();
+    auto s = std::make_shared<conflict_free_schedule<I>>(ex.offset.data(), ex.inc.size(), ex.data.size(), width);
+    state.counters["fill"] = ex.inc.size()/double(s->batches()*width);
+
+    run_benchmark<V, I>(state, [s](indirect_example<V, I>& ex) { conflict_free_apply(*s, ex); }, std::move(ex));
+}
+
+template <typename V, typename I>
+void run_conflict_free_build(benchmark::State& state, indirect_example<V, I> ex) {
+    constexpr unsigned width = conflict_free_width<V, I>();
+    std::size_t incsz = ex.inc.size();
+
+    for (auto _: state) {
+        conflict_free_schedule<I> s(ex.offset.data(), incsz, ex.data.size(), width);
+        benchmark::DoNotOptimize(s.perm.data());
+    }
+
+    conflict_free_schedule<I> s(ex.offset.data(), incsz, ex.data.size(), width);
+    state.counters["bytes"] = s.bytes();
+    state.counters["overhead"] = s.bytes()/double(sizeof(I)*incsz);
+    state.counters["batches"] = s.batches();
+}
+
+// Registration of the conflict-free benchmarks for each case, dispatched on
+// whether there is a kernel for V and I, so that conflict_free_apply is
+// only instantiated where it is defined.
+
+template <typename V, typename I, typename Cases>
+void register_conflict_free(const std::string&, const Cases&, std::false_type) {}
+
+template <typename V, typename I, typename Cases>
+void register_conflict_free(const std::string& prefix, const Cases& cases, std::true_type) {
+    for (auto& c: cases) {
+        auto b = benchmark::RegisterBenchmark((prefix+"/conflict_free/"+c.name).c_str(),
+           [=](auto& st) { run_conflict_free_benchmark<V, I>(st, c.make(st.range(0))); });
+        b->ArgName("N");
+        for (auto N: c.Ns) b->Arg(N);
+
+        b = benchmark::RegisterBenchmark((prefix+"/conflict_free_build/"+c.name).c_str(),
+           [=](auto& st) { run_conflict_free_build<V, I>(st, c.make(st.range(0))); });
+        b->ArgName("N");
+        for (auto N: c.Ns) b->Arg(N);
+    }
+}
+
+// Deferred binning: updates are collected in a staging buffer. Every
+// flush_size updates, the staged updates are partitioned by destination
+// block of 2^block_bits data elements (a counting sort, preserving order)
+// and then applied bin by bin, so that the writes of each bin are confined
+// to one cache-sized block of data.
+
+template <typename V, typename I>
+struct binned_adder {
+    unsigned block_bits;
+    std::size_t flush_size;
+
+    V* data = nullptr;
+    std::size_t nbins = 0;
+    std::size_t n = 0;
+
+    padded_vector<I> stage_offset, bin_offset;
+    padded_vector<V> stage_inc, bin_inc;
+    std::vector<std::size_t> count;
+
+    // Buffers are sized on first bind, so that copies of an unused adder
+    // (e.g. in registered benchmarks) hold no storage.
+    binned_adder(std::size_t block_bytes, std::size_t flush_size):
+        block_bits(0), flush_size(flush_size)
+    {
+        while ((sizeof(V)<<(block_bits+1))<=block_bytes) ++block_bits;
+    }
+
+    void bind(V* p, std::size_t datasz) {
+        flush();
+        if (stage_offset.size()!=flush_size) {
+            stage_offset.resize(flush_size);
+            bin_offset.resize(flush_size);
+            stage_inc.resize(flush_size);
+            bin_inc.resize(flush_size);
+        }
+        data = p;
+        nbins = (datasz>>block_bits)+1;
+    }
+
+    void add(I o, V x) {
+        stage_offset[n] = o;
+        stage_inc[n] = x;
+        if (++n==flush_size) flush();
+    }
+
+    void flush() {
+        if (!n) return;
+
+        count.assign(nbins+1, 0);
+        for (std::size_t i = 0; i<n; ++i) {
+            ++count[(stage_offset[i]>>block_bits)+1];
+        }
+        std::partial_sum(count.begin(), count.end(), count.begin());
+
+        for (std::size_t i = 0; i<n; ++i) {
+            std::size_t k = count[stage_offset[i]>>block_bits]++;
+            bin_offset[k] = stage_offset[i];
+            bin_inc[k] = stage_inc[i];
+        }
+
+        for (std::size_t k = 0; k<n; ++k) {
+            data[bin_offset[k]] += bin_inc[k];
+        }
+        n = 0;
+    }
+};
+
+template <typename V, typename I>
+struct binned_impl {
+    binned_adder<V, I> adder;
+
+    binned_impl(std::size_t block_bytes, std::size_t flush_size):
+        adder(block_bytes, flush_size) {}
+
+    void operator()(indirect_example<V, I>& ex) {
+        std::size_t incsz = ex.inc.size();
+
+        const V* a = ex.inc.data();
+        const I* o = ex.offset.data();
+
+        adder.bind(ex.data.data(), ex.data.size());
+        for (std::size_t i = 0; i<incsz; ++i) {
+            adder.add(o[i], a[i]);
+        }
+        adder.flush();
+    }
+};
+
+// Multithreaded implementations: each is parameterized by thread count, and
+// keeps any scratch storage between calls so that the benchmark measures
+// the accumulation, not the allocation.
+
+// Privatized: each thread accumulates its share of the increments into
+// a private copy of data, followed by a parallel merge over data.
+
+template <typename V, typename I>
+struct private_impl {
+    int nthreads;
+    padded_vector<V> priv;
+
+    explicit private_impl(int nthreads): nthreads(nthreads) {}
+
+    void operator()(indirect_example<V, I>& ex) {
+        std::size_t datasz = ex.data.size();
+        std::size_t incsz = ex.inc.size();
+        if (priv.size()!=nthreads*datasz) priv.resize(nthreads*datasz);
+
+        V* p = ex.data.data();
+        const V* a = ex.inc.data();
+        const I* o = ex.offset.data();
+
+        #pragma omp parallel num_threads(nthreads)
+        {
+            int nt = omp_get_num_threads();
+            V* q = priv.data()+omp_get_thread_num()*datasz;
+            std::fill(q, q+datasz, V(0));
+
+            #pragma omp for schedule(static)
+            for (std::size_t i = 0; i<incsz; ++i) {
+                q[o[i]] += a[i];
+            }
+
+            #pragma omp for schedule(static)
+            for (std::size_t j = 0; j<datasz; ++j) {
+                V acc = 0;
+                for (int t = 0; t<nt; ++t) acc += priv[t*datasz+j];
+                p[j] += acc;
+            }
+        }
+    }
+};
+
+// Owner partitioned: data is split into one contiguous index range per
+// thread. Each thread buckets its share of the increments by owning thread
+// (counting sort, preserving order), and then each owner applies its
+// bucket without contention.
+
+template <typename V, typename I>
+struct owner_impl {
+    int nthreads;
+    std::vector<std::size_t> count;
+    padded_vector<std::size_t> pos;     // bucket cursors, one row per thread
+    padded_vector<V> bucket_inc;
+    padded_vector<I> bucket_offset;
+
+    explicit owner_impl(int nthreads): nthreads(nthreads) {}
+
+    void operator()(indirect_example<V, I>& ex) {
+        std::size_t datasz = ex.data.size();
+        std::size_t incsz = ex.inc.size();
+        if (bucket_inc.size()!=incsz) {
+            bucket_inc.resize(incsz);
+            bucket_offset.resize(incsz);
+        }
+
+        V* p = ex.data.data();
+        const V* a = ex.inc.data();
+        const I* o = ex.offset.data();
+
+        #pragma omp parallel num_threads(nthreads)
+        {
+            std::size_t nt = omp_get_num_threads();
+            std::size_t t = omp_get_thread_num();
+
+            // Rows of pos rounded up to a cache line, to avoid false sharing.
+            std::size_t row = (nt+7)/8*8;
+
+            #pragma omp single
+            {
+                count.assign(nt*nt+1, 0);
+                if (pos.size()<nt*row) pos.resize(nt*row);
+            }
+
+            auto owner = [=](I k) { return std::size_t(k)*nt/datasz; };
+            std::size_t b = t*incsz/nt, e = (t+1)*incsz/nt;
+
+            // count[u*nt+t]: number of updates from thread t to owner u.
+            for (std::size_t i = b; i<e; ++i) {
+                ++count[owner(o[i])*nt+t];
+            }
+            #pragma omp barrier
+
+            #pragma omp single
+            {
+                std::size_t sum = 0;
+                for (auto& c: count) {
+                    std::size_t n = c;
+                    c = sum;
+                    sum += n;
+                }
+            }
+
+            std::size_t* cursor = pos.data()+t*row;
+            for (std::size_t u = 0; u<nt; ++u) cursor[u] = count[u*nt+t];
+
+            for (std::size_t i = b; i<e; ++i) {
+                std::size_t k = cursor[owner(o[i])]++;
+                bucket_offset[k] = o[i];
+                bucket_inc[k] = a[i];
+            }
+            #pragma omp barrier
+
+            std::size_t kb = count[t*nt], ke = count[(t+1)*nt];
+            for (std::size_t k = kb; k<ke; ++k) {
+                p[bucket_offset[k]] += bucket_inc[k];
+            }
+        }
+    }
+};
+
+// Atomic: every thread applies its share of increments directly,
+// with a compare-and-swap loop for each double addition.
+
+template <typename V>
+inline void atomic_add(V* p, V x) {
+    V old;
+    __atomic_load(p, &old, __ATOMIC_RELAXED);
+
+    V sum = old+x;
+    while (!__atomic_compare_exchange(p, &old, &sum, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        sum = old+x;
+    }
+}
+
+template <typename V, typename I>
+struct atomic_impl {
+    int nthreads;
+
+    explicit atomic_impl(int nthreads): nthreads(nthreads) {}
+
+    void operator()(indirect_example<V, I>& ex) {
+        std::size_t incsz = ex.inc.size();
+
+        V* p = ex.data.data();
+        const V* a = ex.inc.data();
+        const I* o = ex.offset.data();
+
+        #pragma omp parallel for num_threads(nthreads) schedule(static)
+        for (std::size_t i = 0; i<incsz; ++i) {
+            atomic_add(p+o[i], a[i]);
+        }
+    }
+};
+
+template <typename V, typename I>
+void register_benchmarks(const std::string& prefix, const std::vector<std::string>& traces, bool has_avx2, bool has_avx512) {
+    using example = indirect_example<V, I>;
+
+    // Kernels with monotonic_only set are run only on cases with monotonic offsets.
+    struct kernel {
+        std::string name;
+        indirect_add_fn<V, I> fn;
+        bool supported;
+        bool monotonic_only;
+    };
+
+    kernel kernels[] = {
+        {"naive", naive_impl<V, I>, true, false},
+        {"scalar", scalar_impl<V, I>, true, false},
+        {"avx2", avx2_kernel<V, I>(), has_avx2, false},
+        {"avx512", avx512_kernel<V, I>(), has_avx512, false},
+        {"binned", binned_impl<V, I>(256*1024, 1<<20), true, false},
+        {"segmented_avx2", segmented_avx2_kernel<V, I>(), has_avx2, true},
+        {"segmented_avx512", segmented_avx512_kernel<V, I>(), has_avx512, true}
+    };
+
+    std::vector<kernel> impls;
+    std::cerr << "#kernels " << prefix << ":";
+    for (auto& k: kernels) {
+        if (!k.supported || !k.fn) continue;
+        impls.push_back(k);
+        std::cerr << " " << k.name;
+    }
+    std::cerr << "\n";
+
+    using make_parallel_fn = std::function<indirect_add_fn<V, I> (int)>;
+    std::vector<std::pair<std::string, make_parallel_fn>> parallel_impls = {
+        {"private", [](int n) { return private_impl<V, I>(n); }},
+        {"owner", [](int n) { return owner_impl<V, I>(n); }},
+        {"atomic", [](int n) { return atomic_impl<V, I>(n); }}
+    };
+
+    using make_example_fn = std::function<example (std::size_t)>;
+
+    struct example_case {
+        std::string name;
+        make_example_fn make;
+        std::vector<std::size_t> Ns;
+        bool monotonic;
+    };
+
+    auto uniform = [](double sparsity, bool monotonic) -> make_example_fn {
+        return [=](std::size_t N) {
+            std::minstd_rand R;
+            return generate_example<V, I>(N, sparsity, monotonic, R);
+        };
+    };
+
+    // Synthetic offset patterns with α = 1.
+    using offset_gen_fn = std::function<void (I*, std::size_t, std::size_t, std::minstd_rand&)>;
+    auto synthetic = [](offset_gen_fn gen) -> make_example_fn {
+        return [=](std::size_t N) {
+            std::minstd_rand R;
+            return generate_example_with<V, I>(N, N, gen, R);
+        };
+    };
+
+    std::size_t small = 10240, medium = 1<<20, large = 1<<24;
+
+    std::vector<example_case> cases = {
+        {"sparse", uniform(0.1, false), {small, medium}, false},
+        {"dense", uniform(10, false), {small, medium}, false},
+        {"very_dense", uniform(100, false), {small}, false},
+        {"dense_monotonic", uniform(10, true), {small, medium}, true},
+        {"very_dense_monotonic", uniform(100, true), {small}, true},
+        {"zipf", synthetic([](I* o, std::size_t n, std::size_t N, std::minstd_rand& R) {
+            zipf_offsets(o, n, N, 1.0, R); }), {medium, large}, false},
+        {"zipf_monotonic", synthetic([](I* o, std::size_t n, std::size_t N, std::minstd_rand& R) {
+            zipf_offsets(o, n, N, 1.0, R); std::sort(o, o+n); }), {medium, large}, true},
+        {"clustered", synthetic([](I* o, std::size_t n, std::size_t N, std::minstd_rand& R) {
+            clustered_offsets(o, n, N, N/4096, 64., R); }), {medium, large}, false},
+        {"blocked_sorted", synthetic([](I* o, std::size_t n, std::size_t N, std::minstd_rand& R) {
+            blocked_sorted_offsets(o, n, N, 4096, R); }), {medium, large}, false}
     };
 
-#if defined(__AVX512F__)
-    impls.push_back({"avx512", avx512_impl});
-#endif
+    for (auto& path: traces) {
+        mapped_trace t(path);
+        if (t.data_size()>std::size_t(std::numeric_limits<I>::max())) continue;
 
-    std::size_t N = 10240;
-    double sparse = 0.1, dense = 10, very_dense = 100;
+        cases.push_back({"trace:"+path.substr(path.find_last_of('/')+1),
+            [path](std::size_t) { return load_trace_example<example>(path); },
+            {t.data_size()}, false});
+    }
+
+    int max_threads = omp_get_max_threads();
 
     for (auto& impl: impls) {
-        benchmark::RegisterBenchmark((impl.first+"/sparse").c_str(),
-           [&](auto& st) { run_benchmark(st, impl.second, N, sparse, false); });
-        benchmark::RegisterBenchmark((impl.first+"/dense").c_str(),
-           [&](auto& st) { run_benchmark(st, impl.second, N, dense, false); });
-        benchmark::RegisterBenchmark((impl.first+"/very_dense").c_str(),
-           [&](auto& st) { run_benchmark(st, impl.second, N, very_dense, false); });
-        benchmark::RegisterBenchmark((impl.first+"/dense_monotonic").c_str(),
-           [&](auto& st) { run_benchmark(st, impl.second, N, dense, true); });
-        benchmark::RegisterBenchmark((impl.first+"/very_dense_monotonic").c_str(),
-           [&](auto& st) { run_benchmark(st, impl.second, N, very_dense, true); });
+        for (auto& c: cases) {
+            if (impl.monotonic_only && !c.monotonic) continue;
+
+            auto b = benchmark::RegisterBenchmark((prefix+"/"+impl.name+"/"+c.name).c_str(),
+               [=](auto& st) { run_benchmark<V, I>(st, impl.fn, c.make(st.range(0))); });
+
+            b->ArgName("N");
+            for (auto N: c.Ns) b->Arg(N);
+        }
+    }
+
+    // Cached segment index, for any offsets: per-step cost, and the cost of one build.
+    for (auto& c: cases) {
+        auto b = benchmark::RegisterBenchmark((prefix+"/segment_index/"+c.name).c_str(),
+           [=](auto& st) { run_segment_index_benchmark<V, I>(st, c.make(st.range(0))); });
+        b->ArgName("N");
+        for (auto N: c.Ns) b->Arg(N);
+
+        b = benchmark::RegisterBenchmark((prefix+"/segment_index_build/"+c.name).c_str(),
+           [=](auto& st) { run_segment_index_build<V, I>(st, c.make(st.range(0))); });
+        b->ArgName("N");
+        for (auto N: c.Ns) b->Arg(N);
+    }
+
+    // Conflict-free batches for the AVX512 gather-add-scatter kernel:
+    // per-step cost, and the cost of building the schedule.
+    if (has_avx512) {
+        register_conflict_free<V, I>(prefix, cases, std::integral_constant<bool, conflict_free_width<V, I>()!=0>{});
+    }
+
+    // Deferred binning against naive with α = 1, for data sizes from L2 to
+    // several GB, over destination block size and flush threshold.
+    std::vector<std::size_t> sweep_Ns = {1<<15, 1<<18, 1<<21, 1<<24, 1<<27};
+    auto sweep = uniform(1, false);
+
+    auto b = benchmark::RegisterBenchmark((prefix+"/naive/size_sweep").c_str(),
+        [=](auto& st) { run_benchmark<V, I>(st, naive_impl<V, I>, sweep(st.range(0))); });
+    b->ArgName("N");
+    for (auto N: sweep_Ns) b->Arg(N);
+
+    b = benchmark::RegisterBenchmark((prefix+"/binned/size_sweep").c_str(),
+        [=](auto& st) { run_benchmark<V, I>(st, binned_impl<V, I>(st.range(1)*1024, st.range(2)), sweep(st.range(0))); });
+    b->ArgNames({"N", "block_kib", "flush"});
+    for (auto N: sweep_Ns) {
+        for (long block_kib: {32, 256, 2048}) {
+            for (long flush: {1<<16, 1<<20}) b->Args({(long)N, block_kib, flush});
+        }
+    }
+
+    // Page size and NUMA placement of the example data, for naive and for
+    // atomic on all threads, with α = 1 at sizes well beyond the TLB reach
+    // of 4 KiB pages. Policies which cannot be satisfied (e.g. no reserved
+    // huge pages) are reported as errors.
+    std::vector<memory_policy> policies = {
+        {},
+        {page_kind::transparent_huge},
+        {page_kind::explicit_huge},
+        {page_kind::normal, numa_placement::interleave},
+        {page_kind::transparent_huge, numa_placement::interleave}
+    };
+
+    for (auto& mp: policies) {
+        auto make = [mp](std::size_t N) {
+            std::minstd_rand R;
+            return generate_example<V, I>(N, 1, false, R, mp);
+        };
+
+        auto run_with = [make](auto& st, indirect_add_fn<V, I> fn) {
+            try {
+                run_benchmark<V, I>(st, fn, make(st.range(0)));
+            }
+            catch (std::exception& e) {
+                st.SkipWithError(e.what());
+            }
+        };
+
+        auto b = benchmark::RegisterBenchmark((prefix+"/naive/alloc:"+to_string(mp)).c_str(),
+            [=](auto& st) { run_with(st, naive_impl<V, I>); });
+        b->ArgName("N")->Arg(1<<24)->Arg(1<<27);
+
+        b = benchmark::RegisterBenchmark((prefix+"/atomic/alloc:"+to_string(mp)).c_str(),
+            [=](auto& st) { run_with(st, atomic_impl<V, I>(st.range(1))); });
+        b->ArgNames({"N", "threads"})->UseRealTime();
+        b->Args({1<<24, max_threads})->Args({1<<27, max_threads});
     }
+
+    for (auto& impl: parallel_impls) {
+        for (auto& c: cases) {
+            auto b = benchmark::RegisterBenchmark((prefix+"/"+impl.first+"/"+c.name).c_str(),
+               [=](auto& st) { run_benchmark<V, I>(st, impl.second(st.range(1)), c.make(st.range(0))); });
+
+            b->ArgNames({"N", "threads"})->UseRealTime();
+            for (auto N: c.Ns) {
+                for (int t = 1; t<max_threads; t *= 2) b->Args({(long)N, t});
+                b->Args({(long)N, max_threads});
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    auto traces = take_trace_args(argc, argv);
+
+    __builtin_cpu_init();
+    bool has_avx2 = __builtin_cpu_supports("avx2");
+    bool has_avx512 = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512cd");
+
+    register_benchmarks<double, int>("f64_i32", traces, has_avx2, has_avx512);
+    register_benchmarks<float, int>("f32_i32", traces, has_avx2, has_avx512);
+    register_benchmarks<double, std::int64_t>("f64_i64", traces, has_avx2, has_avx512);
+    register_benchmarks<float, std::int64_t>("f32_i64", traces, has_avx2, has_avx512);
+
     benchmark::Initialize(&argc, argv);
     benchmark::RunSpecifiedBenchmarks();
 }
-
@@ -0,0 +1,254 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <limits>
+#include <utility>
+
+#include <immintrin.h>
+
+#include "augmaxheap.h"
+#include "padded-allocator.h"
+
+// D-ary max heap of intervals by left hand value, with the subtree minimum
+// of the right hand value at each node, as aug_max_heap, but with the
+// left hand values, right hand values and subtree minima in separate
+// (structure of arrays) 64-byte aligned arrays.
+//
+// The arrays are offset by D-1 elements so that the D children of a node
+// are contiguous and aligned to D elements: with 32-bit values and D = 4
+// or 8, finding the greatest child (down) and the least child subtree
+// minimum (update_min_second) is a single SSE or AVX2 load and reduction.
+// The slots after the last element of the final group of children are
+// kept filled with sentinels (lowest left value, greatest minimum) so that
+// the whole group can be read.
+
+template <typename T, unsigned D>
+struct dary_children {
+    static unsigned argmax(const T* x) {
+        unsigned c = 0;
+        for (unsigned i = 1; i<D; ++i) if (x[i]>x[c]) c = i;
+        return c;
+    }
+
+    static T min(const T* x) {
+        T m = x[0];
+        for (unsigned i = 1; i<D; ++i) m = std::min(m, x[i]);
+        return m;
+    }
+};
+
+#ifdef __SSE4_1__
+template <>
+struct dary_children<int, 4> {
+    static unsigned argmax(const int* x) {
+        __m128i v = _mm_load_si128((const __m128i*)x);
+        __m128i m = _mm_max_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+        m = _mm_max_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+        return __builtin_ctz(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, m))));
+    }
+
+    static int min(const int* x) {
+        __m128i v = _mm_load_si128((const __m128i*)x);
+        __m128i m = _mm_min_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+        m = _mm_min_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtsi128_si32(m);
+    }
+};
+#endif
+
+#ifdef __AVX2__
+template <>
+struct dary_children<int, 8> {
+    static unsigned argmax(const int* x) {
+        __m256i v = _mm256_load_si256((const __m256i*)x);
+        __m256i m = _mm256_max_epi32(v, _mm256_permute2x128_si256(v, v, 1));
+        m = _mm256_max_epi32(m, _mm256_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+        m = _mm256_max_epi32(m, _mm256_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+        return __builtin_ctz(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, m))));
+    }
+
+    static int min(const int* x) {
+        __m256i v = _mm256_load_si256((const __m256i*)x);
+        __m256i m = _mm256_min_epi32(v, _mm256_permute2x128_si256(v, v, 1));
+        m = _mm256_min_epi32(m, _mm256_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+        m = _mm256_min_epi32(m, _mm256_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm256_cvtsi256_si32(m);
+    }
+};
+#endif
+
+template <typename T, unsigned D = 4>
+struct aug_dary_max_heap {
+    static_assert(D>=2, "heap arity must be at least two");
+
+    using value_type = interval<T>;
+    using size_type = std::size_t;
+    using const_reference = value_type;
+    using reference = value_type;
+
+    size_type size() const { return n_; }
+    bool empty() const { return !n_; }
+
+    aug_dary_max_heap() {}
+
+    template <typename I>
+    aug_dary_max_heap(I b, I e) {
+        for (; b!=e; ++b) {
+            grow();
+            set(n_++, *b);
+        }
+        if (n_>1) {
+            for (size_type k = (n_-2)/D+1; k-->0; ) down(k);
+        }
+        for (size_type k = n_; k-->0; ) update_min_second(k);
+    }
+
+    struct iterator {
+        const aug_dary_max_heap* h = nullptr;
+        size_type k = 0;
+
+        using value_type = aug_dary_max_heap::value_type;
+        using pointer_type = const value_type*;
+        using reference = value_type;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() = default;
+        iterator(const aug_dary_max_heap* h, size_type k): h(h), k(k) {}
+
+        iterator& operator++() { ++k; return *this; }
+        iterator operator++(int) { return iterator(h, k++); }
+
+        bool operator==(iterator j) const { return k==j.k; }
+        bool operator!=(iterator j) const { return k!=j.k; }
+
+        reference operator*() const { return h->at(k); }
+    };
+
+    using const_iterator = iterator;
+
+    iterator begin() const { return iterator(this, 0); }
+    iterator end() const { return iterator(this, n_); }
+
+    T min_second() const { return min_second_[off]; }
+    value_type top() const { return at(0); }
+
+    void push_back(value_type p) {
+        grow();
+        size_type k = n_++;
+        set(k, p);
+        up(k);
+        update_path(k);
+        check_invariants();
+    }
+
+    void pop() {
+        if (empty()) return;
+
+        size_type last = --n_;
+        if (last) {
+            move(0, last);
+            clear(last);
+            update_path(parent(last));
+            update_path(down(0));
+        }
+        else {
+            clear(0);
+        }
+        check_invariants();
+    }
+
+    void check_invariants() {
+#ifdef HEAP_DEBUG
+        for (size_type i = 0; i<n_; ++i) {
+            T m = second_[off+i];
+            for (size_type c = D*i+1; c<=D*i+D && c<n_; ++c) {
+                assert(first_[off+i]>=first_[off+c]);
+                m = std::min(m, min_second_[off+c]);
+            }
+            assert(min_second_[off+i]==m);
+        }
+#endif
+    }
+
+private:
+    static constexpr size_type off = D-1;
+
+    size_type n_ = 0;
+    padded_vector<T> first_, second_, min_second_;
+
+    static size_type parent(size_type k) { return (k-1)/D; }
+
+    value_type at(size_type k) const { return {first_[off+k], second_[off+k]}; }
+
+    // Keep room for the whole group of children of the last node.
+    void grow() {
+        size_type need = off+(n_/D+1)*D+D;
+        if (first_.size()<need) {
+            size_type cap = std::max(need, 2*first_.size());
+            first_.resize(cap, std::numeric_limits<T>::lowest());
+            second_.resize(cap, std::numeric_limits<T>::max());
+            min_second_.resize(cap, std::numeric_limits<T>::max());
+        }
+    }
+
+    void set(size_type k, value_type p) {
+        first_[off+k] = p.first;
+        second_[off+k] = p.second;
+        min_second_[off+k] = p.second;
+    }
+
+    void clear(size_type k) {
+        first_[off+k] = std::numeric_limits<T>::lowest();
+        second_[off+k] = std::numeric_limits<T>::max();
+        min_second_[off+k] = std::numeric_limits<T>::max();
+    }
+
+    void move(size_type to, size_type from) {
+        first_[off+to] = first_[off+from];
+        second_[off+to] = second_[off+from];
+    }
+
+    void swap(size_type a, size_type b) {
+        std::swap(first_[off+a], first_[off+b]);
+        std::swap(second_[off+a], second_[off+b]);
+    }
+
+    void update_min_second(size_type k) {
+        T m = second_[off+k];
+        size_type c = D*k+1;
+        if (c<n_) m = std::min(m, dary_children<T, D>::min(&min_second_[off+c]));
+        min_second_[off+k] = m;
+    }
+
+    void update_path(size_type k) {
+        for (;;) {
+            update_min_second(k);
+            if (!k) return;
+            k = parent(k);
+        }
+    }
+
+    void up(size_type k) {
+        while (k!=0) {
+            size_type p = parent(k);
+            if (first_[off+p]>=first_[off+k]) break;
+            swap(p, k);
+            k = p;
+        }
+    }
+
+    // Returns final position; min_second is not updated.
+    size_type down(size_type k) {
+        for (;;) {
+            size_type c = D*k+1;
+            if (c>=n_) return k;
+
+            c += dary_children<T, D>::argmax(&first_[off+c]);
+            if (first_[off+k]>=first_[off+c]) return k;
+            swap(k, c);
+            k = c;
+        }
+    }
+};
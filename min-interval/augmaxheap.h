@@ -1,46 +1,74 @@
 #pragma once
 
+#include <algorithm>
 #include <cassert>
 #include <iterator>
+#include <memory>
 #include <numeric>
 #include <utility>
 #include <vector>
 
+#include "staticvector.h"
+
 template <typename T>
 using interval = std::pair<T, T>;
 
+// Bulk insertion strategy: push each element in turn (sift up), append
+// all and re-heapify in O(n+k), or choose by batch size: re-heapify when
+// the batch is at least a quarter of the heap.
+enum class batch_insert { sift_up, rebuild, automatic };
+
+template <typename T>
+struct aug_heap_item: interval<T> {
+    T min_second;
+
+    aug_heap_item() {}
+    aug_heap_item(interval<T> x): interval<T>(x), min_second(x.second) {}
+};
+
 // Binary max heap of intervals by left hand value,
 // where we also store at each node the subtree minimum
 // of the right hand value.
-
-template <typename T>
+//
+// Items are held in a Container, by default a std::vector with allocator
+// Alloc (rebound to the item type). Once storage is reserved, push_back
+// and pop do not allocate. For inline, fixed capacity storage use
+// inline_aug_max_heap, with a static_vector (staticvector.h).
+
+template <
+    typename T,
+    typename Alloc = std::allocator<interval<T>>,
+    typename Container = std::vector<aug_heap_item<T>,
+        typename std::allocator_traits<Alloc>::template rebind_alloc<aug_heap_item<T>>>
+>
 struct aug_max_heap {
     using value_type = interval<T>;
     using size_type = std::size_t;
     using const_reference = const value_type&;
     using reference = const value_type&;
+    using item = aug_heap_item<T>;
+    using container_type = Container;
 
-    struct item: value_type {
-        T min_second;
-
-        item() {}
-        item(value_type x): value_type(x), min_second(x.second) {}
-    };
-
-    std::vector<item> heap;
+    Container heap;
 
     size_type size() const { return heap.size(); }
     bool empty() const { return !heap.size(); }
 
     aug_max_heap() {}
 
+    explicit aug_max_heap(const Alloc& alloc): heap(alloc) {}
+
     template <typename I>
     aug_max_heap(I b, I e): heap(b, e) {
         for (size_type k = size()/2; k-->0; ) down(k);
     }
 
+    void reserve(size_type n) { heap.reserve(n); }
+    size_type capacity() const { return heap.capacity(); }
+    void clear() { heap.clear(); }
+
     struct iterator {
-        using inner = typename std::vector<item>::const_iterator;
+        using inner = typename Container::const_iterator;
         inner i;
 
         using value_type = aug_max_heap::value_type;
@@ -78,9 +106,6 @@ struct aug_max_heap {
     void pop() {
         if (empty()) return;
 
-#ifndef NDEBUG
-        auto keep = heap;
-#endif
         check_invariants();
         std::swap(heap.front(), heap.back());
 
@@ -101,8 +126,36 @@ struct aug_max_heap {
         check_invariants();
     }
 
+    // Insert [b, e) (forward iterators).
+    template <typename I>
+    void insert_batch(I b, I e, batch_insert how = batch_insert::automatic) {
+        if (choose(b, e, how)==batch_insert::sift_up) {
+            for (; b!=e; ++b) push_back(*b);
+        }
+        else {
+            heap.insert(heap.end(), b, e);
+            rebuild();
+        }
+    }
+
+    // Remove elements with first >= bound, and insert [b, e). With
+    // rebuild, the heap is compacted in place before re-heapifying.
+    template <typename I>
+    void insert_batch(I b, I e, batch_insert how, T bound) {
+        if (choose(b, e, how)==batch_insert::sift_up) {
+            while (!empty() && top().first>=bound) pop();
+            for (; b!=e; ++b) push_back(*b);
+        }
+        else {
+            heap.erase(std::remove_if(heap.begin(), heap.end(),
+                [bound](const item& x) { return x.first>=bound; }), heap.end());
+            heap.insert(heap.end(), b, e);
+            rebuild();
+        }
+    }
+
     void check_invariants() {
-#ifndef NDEBUG
+#ifdef HEAP_DEBUG
         if (heap.empty()) return;
         for (size_type i = 0; i<size(); ++i) {
             auto& el = heap[i];
@@ -172,6 +225,32 @@ private:
         check_invariants();
     }
 
+    template <typename I>
+    batch_insert choose(I b, I e, batch_insert how) const {
+        if (how!=batch_insert::automatic) return how;
+        return 4*size_type(std::distance(b, e))>=size()? batch_insert::rebuild: batch_insert::sift_up;
+    }
+
+    // Bottom-up heap construction by first, then min_second recomputed
+    // from the leaves.
+    void rebuild() {
+        for (size_type k = size()/2; k-->0; ) {
+            for (size_type j = k;;) {
+                size_type c = 2*j+1;
+                if (c>=size()) break;
+                if (c+1<size() && heap[c+1].first>heap[c].first) ++c;
+                if (heap[j].first>=heap[c].first) break;
+                std::swap(heap[j], heap[c]);
+                j = c;
+            }
+        }
+        for (size_type k = size(); k-->0; ) {
+            heap[k].min_second = heap[k].second;
+            update_min_second(k);
+        }
+        check_invariants();
+    }
+
     void up(size_type k) {
         while (k!=0) {
             size_type p = (k-1)/2;
@@ -191,3 +270,6 @@ private:
         }
     }
 };
+
+template <typename T, std::size_t N>
+using inline_aug_max_heap = aug_max_heap<T, std::allocator<interval<T>>, static_vector<aug_heap_item<T>, N>>;
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "augmaxheap.h"
+
+// Change feeds for the online min-interval structures: a sink is told of
+// each interval added to the minimal set and of each interval evicted from
+// it, in the order the changes are made (evictions caused by an insertion
+// come before the insertion).
+//
+// A sink provides added(const interval<T>&) and evicted(const interval<T>&),
+// and a static constexpr bool enabled; the structures skip any work done
+// only for the feed when enabled is false.
+
+template <typename T>
+struct null_feed {
+    static constexpr bool enabled = false;
+
+    void added(const interval<T>&) {}
+    void evicted(const interval<T>&) {}
+};
+
+template <typename T>
+struct interval_delta {
+    enum kind_type: std::uint8_t { added, evicted };
+
+    kind_type kind;
+    interval<T> value;
+};
+
+// Fixed capacity ring buffer of deltas. If the consumer falls behind, the
+// oldest deltas are overwritten and counted in overrun: a consumer that sees
+// a non-zero overrun should resynchronise from the structure itself.
+template <typename T>
+struct delta_ring {
+    static constexpr bool enabled = true;
+
+    // Capacity is rounded up to a power of two.
+    explicit delta_ring(std::size_t capacity = 1024) {
+        std::size_t c = 1;
+        while (c<capacity) c *= 2;
+        buf_.resize(c);
+        mask_ = c-1;
+    }
+
+    void added(const interval<T>& p) { push({interval_delta<T>::added, p}); }
+    void evicted(const interval<T>& p) { push({interval_delta<T>::evicted, p}); }
+
+    bool empty() const { return head_==tail_; }
+    std::size_t size() const { return head_-tail_; }
+    std::size_t capacity() const { return buf_.size(); }
+
+    // Remove and return the oldest delta; false if empty.
+    bool pop(interval_delta<T>& d) {
+        if (empty()) return false;
+        d = buf_[tail_++&mask_];
+        return true;
+    }
+
+    void clear() { tail_ = head_; }
+
+    std::uint64_t overrun = 0;
+
+private:
+    std::vector<interval_delta<T>> buf_;
+    std::size_t mask_ = 0;
+    std::uint64_t head_ = 0, tail_ = 0;
+
+    void push(interval_delta<T> d) {
+        if (size()==buf_.size()) {
+            ++tail_;
+            ++overrun;
+        }
+        buf_[head_++&mask_] = d;
+    }
+};
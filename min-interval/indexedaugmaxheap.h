@@ -0,0 +1,184 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "augmaxheap.h"
+
+// Binary max heap of intervals by left hand value, augmented with the
+// subtree minimum of the right hand value as in aug_max_heap, where each
+// interval is also addressable by a handle for removal.
+//
+// Handles are issued in insertion order (a sequence number), so that
+// handle order is age order. The heap position of each live handle is kept
+// in a deque indexed from the oldest live handle; removing the oldest
+// interval trims the deque from the front.
+//
+// After any move in the heap, min_second is recomputed along the path from
+// the lowest moved node to the root, so push_back and erase are O(log n).
+
+template <typename T>
+struct indexed_aug_max_heap {
+    using value_type = interval<T>;
+    using size_type = std::size_t;
+    using handle = std::uint64_t;
+
+    struct item: value_type {
+        T min_second;
+        handle id;
+
+        item() {}
+        item(value_type x, handle id): value_type(x), min_second(x.second), id(id) {}
+    };
+
+    std::vector<item> heap;
+
+    size_type size() const { return heap.size(); }
+    bool empty() const { return !heap.size(); }
+
+    T min_second() const { return heap[0].min_second; }
+    const value_type& top() const { return heap[0]; }
+
+    // Oldest live handle, if any.
+    handle oldest() const { return base_; }
+
+    bool contains(handle h) const {
+        return h>=base_ && h-base_<pos_.size() && pos_[h-base_]!=npos;
+    }
+
+    handle push_back(value_type p) {
+        handle h = base_+pos_.size();
+        size_type k = heap.size();
+
+        heap.push_back(item(std::move(p), h));
+        pos_.push_back(k);
+
+        up(k);
+        update_path(k);
+
+        check_invariants();
+        return h;
+    }
+
+    // Remove the interval with handle h; returns false if not present.
+    bool erase(handle h) {
+        if (!contains(h)) return false;
+
+        size_type k = pos_[h-base_];
+        pos_[h-base_] = npos;
+
+        size_type last = heap.size()-1;
+        if (k!=last) {
+            heap[k] = heap[last];
+            pos_[heap[k].id-base_] = k;
+        }
+        heap.pop_back();
+
+        if (k<last) {
+            // Path from the removed last position, then from the refilled node.
+            if (last>0) update_path((last-1)/2);
+
+            if (k>0 && heap[(k-1)/2].first<heap[k].first) {
+                up(k);
+                update_path(k);
+            }
+            else {
+                update_path(down(k));
+            }
+        }
+        else if (k>0) {
+            update_path((k-1)/2);
+        }
+
+        while (!pos_.empty() && pos_.front()==npos) {
+            pos_.pop_front();
+            ++base_;
+        }
+
+        check_invariants();
+        return true;
+    }
+
+    // Remove the oldest interval.
+    void pop_oldest() {
+        if (!empty()) erase(base_);
+    }
+
+    // Remove all intervals with handles before h (i.e. older than h).
+    void erase_before(handle h) {
+        while (!empty() && base_<h) erase(base_);
+    }
+
+    void check_invariants() {
+#ifdef HEAP_DEBUG
+        for (size_type i = 0; i<size(); ++i) {
+            auto& el = heap[i];
+            assert(pos_[el.id-base_]==i);
+
+            T m = el.second;
+            for (size_type c = 2*i+1; c<=2*i+2 && c<size(); ++c) {
+                assert(el.first>=heap[c].first);
+                m = std::min(m, heap[c].min_second);
+            }
+            assert(el.min_second==m);
+        }
+#endif
+    }
+
+private:
+    static constexpr size_type npos = std::numeric_limits<size_type>::max();
+
+    handle base_ = 0;
+    std::deque<size_type> pos_;
+
+    void swap_items(size_type a, size_type b) {
+        std::swap(heap[a], heap[b]);
+        pos_[heap[a].id-base_] = a;
+        pos_[heap[b].id-base_] = b;
+    }
+
+    void update_min_second(size_type p) {
+        T m = heap[p].second;
+        size_type c = 2*p+1;
+        if (c<size()) {
+            m = std::min(m, heap[c].min_second);
+            if (++c<size()) m = std::min(m, heap[c].min_second);
+        }
+        heap[p].min_second = m;
+    }
+
+    void update_path(size_type k) {
+        for (;;) {
+            update_min_second(k);
+            if (!k) return;
+            k = (k-1)/2;
+        }
+    }
+
+    void up(size_type k) {
+        while (k!=0) {
+            size_type p = (k-1)/2;
+            if (heap[p].first>=heap[k].first) break;
+            swap_items(p, k);
+            k = p;
+        }
+    }
+
+    // Returns final position.
+    size_type down(size_type k) {
+        for (;;) {
+            size_type l = 2*k+1, r = l+1, c = k;
+
+            if (r<size()) c = heap[l].first>heap[r].first? l: r;
+            else if (l<size()) c = l;
+
+            if (c==k || heap[k].first>=heap[c].first) return k;
+            swap_items(k, c);
+            k = c;
+        }
+    }
+};
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "augmaxheap.h"
+
+// Minimal intervals for many independent keys.
+//
+// Each key has an unordered candidate list, as in min_interval_vector,
+// with its least right hand value (for O(1) rejection) and its greatest
+// left hand value (to skip the filter when nothing can be evicted).
+//
+// The per-key state is held in an open addressing hash table (linear
+// probing) of fixed size slots. Each slot has inline room for N intervals.
+// Longer lists spill to a shared arena, in blocks of N·2^c intervals that
+// are recycled through per-class free lists. The arena is addressed by
+// offset, so growing it does not disturb the slots.
+//
+// The batched push prefetches the home slot of keys a few places ahead.
+
+template <typename T, typename Key = std::uint64_t, unsigned N = 4>
+struct keyed_min_interval {
+    static_assert(N>0, "inline capacity must be positive");
+
+    std::size_t keys() const { return used_; }
+
+    // Approximate footprint of the table and arena.
+    std::size_t bytes() const {
+        return table_.capacity()*sizeof(slot)+arena_.capacity()*sizeof(interval<T>);
+    }
+
+    void push(Key k, interval<T> ab) {
+        push_slot(find_or_insert(k), ab);
+    }
+
+    void push(const Key* k, const interval<T>* ab, std::size_t n) {
+        constexpr std::size_t ahead = 8;
+        for (std::size_t i = 0; i<n; ++i) {
+            if (i+ahead<n && !table_.empty()) __builtin_prefetch(&table_[home(k[i+ahead])]);
+            push_slot(find_or_insert(k[i]), ab[i]);
+        }
+    }
+
+    // Number of minimal intervals for key k.
+    std::size_t size(Key k) const {
+        const slot* s = find(k);
+        return s? s->size: 0;
+    }
+
+    template <typename F>
+    void for_each(Key k, F f) const {
+        const slot* s = find(k);
+        if (!s) return;
+        const interval<T>* p = data(*s);
+        for (std::uint32_t i = 0; i<s->size; ++i) f(p[i]);
+    }
+
+    // Total number of minimal intervals over all keys.
+    std::size_t size() const {
+        std::size_t n = 0;
+        for (auto& s: table_) n += s.size;
+        return n;
+    }
+
+private:
+    struct slot {
+        Key key{};
+        T min_second, max_first;
+        std::uint32_t size = 0;
+        std::uint32_t cap = 0;      // 0: empty; N: inline; otherwise arena block.
+        std::uint32_t offset = 0;   // Arena offset if spilled.
+        interval<T> local[N];
+    };
+
+    std::vector<slot> table_;
+    std::size_t used_ = 0;
+    unsigned shift_ = 64;
+
+    std::vector<interval<T>> arena_;
+    std::vector<std::vector<std::uint32_t>> free_;
+
+    std::size_t home(Key k) const {
+        return (std::uint64_t(k)*0x9e3779b97f4a7c15ull)>>shift_;
+    }
+
+    const slot* find(Key k) const {
+        if (table_.empty()) return nullptr;
+        std::size_t mask = table_.size()-1;
+        for (std::size_t i = home(k); ; i = (i+1)&mask) {
+            const slot& s = table_[i];
+            if (!s.cap) return nullptr;
+            if (s.key==k) return &s;
+        }
+    }
+
+    slot& find_or_insert(Key k) {
+        if (10*(used_+1)>7*table_.size()) grow();
+
+        std::size_t mask = table_.size()-1;
+        for (std::size_t i = home(k); ; i = (i+1)&mask) {
+            slot& s = table_[i];
+            if (!s.cap) {
+                s.key = k;
+                s.cap = N;
+                s.size = 0;
+                s.min_second = std::numeric_limits<T>::max();
+                s.max_first = std::numeric_limits<T>::lowest();
+                ++used_;
+                return s;
+            }
+            if (s.key==k) return s;
+        }
+    }
+
+    void grow() {
+        std::vector<slot> old(std::max<std::size_t>(16, 2*table_.size()));
+        std::swap(table_, old);
+        shift_ = 64-__builtin_ctzll(table_.size());
+
+        std::size_t mask = table_.size()-1;
+        for (auto& s: old) {
+            if (!s.cap) continue;
+            std::size_t i = home(s.key);
+            while (table_[i].cap) i = (i+1)&mask;
+            table_[i] = s;
+        }
+    }
+
+    interval<T>* data(slot& s) { return s.cap==N? s.local: &arena_[s.offset]; }
+    const interval<T>* data(const slot& s) const { return s.cap==N? s.local: &arena_[s.offset]; }
+
+    static unsigned size_class(std::uint32_t cap) { return __builtin_ctz(cap/N); }
+
+    std::uint32_t allocate(unsigned c) {
+        if (free_.size()>c && !free_[c].empty()) {
+            std::uint32_t off = free_[c].back();
+            free_[c].pop_back();
+            return off;
+        }
+        std::uint32_t off = arena_.size();
+        arena_.resize(arena_.size()+(N<<c));
+        return off;
+    }
+
+    void release(std::uint32_t off, unsigned c) {
+        if (free_.size()<=c) free_.resize(c+1);
+        free_[c].push_back(off);
+    }
+
+    void push_slot(slot& s, interval<T> ab) {
+        if (s.size) {
+            if (ab.first>=s.min_second) return;
+            if (ab.second<=s.max_first) evict(s, ab.second);
+        }
+
+        if (s.size==s.cap) {
+            unsigned c = size_class(s.cap)+1;
+            std::uint32_t off = allocate(c);
+            std::copy(data(s), data(s)+s.size, &arena_[off]);
+            if (s.cap!=N) release(s.offset, size_class(s.cap));
+            s.offset = off;
+            s.cap = N<<c;
+        }
+
+        data(s)[s.size++] = ab;
+        s.min_second = std::min(s.min_second, ab.second);
+        s.max_first = std::max(s.max_first, ab.first);
+    }
+
+    // Remove intervals with left hand value at or above bound.
+    void evict(slot& s, T bound) {
+        interval<T>* p = data(s);
+        T min_second = std::numeric_limits<T>::max();
+        T max_first = std::numeric_limits<T>::lowest();
+
+        std::uint32_t w = 0;
+        for (std::uint32_t i = 0; i<s.size; ++i) {
+            if (p[i].first>=bound) continue;
+            min_second = std::min(min_second, p[i].second);
+            max_first = std::max(max_first, p[i].first);
+            p[w++] = p[i];
+        }
+        s.size = w;
+        s.min_second = min_second;
+        s.max_first = max_first;
+
+        // Return to inline storage when the list fits.
+        if (s.cap!=N && w<=N) {
+            std::copy(p, p+w, s.local);
+            release(s.offset, size_class(s.cap));
+            s.cap = N;
+        }
+    }
+};
@@ -1,51 +1,158 @@
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <limits>
 #include <random>
+#include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include <omp.h>
+#include <unistd.h>
+
 #include "benchmark/benchmark.h"
 
+#include "augdaryheap.h"
 #include "augmaxheap.h"
+#include "changefeed.h"
+#include "indexedaugmaxheap.h"
+#include "keyedmininterval.h"
+#include "padded-allocator.h"
+#include "parallelmininterval.h"
+#include "soacompact.h"
+
+// Every allocation in the process is counted, for bench_min_interval and
+// bench_min_interval_reuse: plain and aligned operator new, and through
+// the padded_allocator hook, the posix_memalign and mmap allocations behind
+// padded_vector. (Not inlined: gcc otherwise warns of a mismatched free of
+// memory from operator new.)
+
+static std::atomic<std::uint64_t> allocation_count{0};
+
+void* operator new(std::size_t n) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n? n: 1)) return p;
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+#ifdef __cpp_aligned_new
+void* operator new(std::size_t n, std::align_val_t al) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    void* p = nullptr;
+    if (!posix_memalign(&p, std::max(std::size_t(al), sizeof(void*)), n? n: 1)) return p;
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+#endif
+
+static const bool count_padded_allocations = [] {
+    padded_allocation_hook_ref() = [](std::size_t) { allocation_count.fetch_add(1, std::memory_order_relaxed); };
+    return true;
+}();
 
 // Problem: partially order a set S of non-empty half-open intervals by
 // [a,b) < [c,d] iff b ≤ c. Find the minimal elements of S.
 
-// Online algorithm: heap based.
-template <typename T>
+// Online algorithm: heap based. Changes to the minimal set are reported
+// to feed (see changefeed.h).
+template <typename T, typename Heap = aug_max_heap<T>, typename Sink = null_feed<T>>
 struct min_interval_heap {
-    aug_max_heap<T> heap;
+    Heap heap;
+    std::vector<interval<T>> batch;
+    Sink feed;
 
     void push_back(interval<T> ab) {
         if (!heap.empty()) {
             if (ab.first>=heap.min_second()) return;
-            while (!heap.empty() && heap.top().first>=ab.second) heap.pop();
+            while (!heap.empty() && heap.top().first>=ab.second) {
+                feed.evicted(heap.top());
+                heap.pop();
+            }
         }
+        feed.added(ab);
         heap.push_back(std::move(ab));
     }
 
-    using iterator = typename aug_max_heap<T>::const_iterator;
+    // Bulk insertion of a batch [b, e) (forward iterators). After the batch,
+    // the minimal set is bounded by the least upper bound of the heap and
+    // batch together: batch elements at or above it are dropped, and heap
+    // elements at or above it are evicted, before the survivors are inserted.
+    // With an enabled feed, evictions are made one by one from the top of
+    // the heap so that they can be reported.
+    template <typename I>
+    void push_range(I b, I e, batch_insert how = batch_insert::automatic) {
+        if (b==e) return;
+
+        T bound = heap.empty()? b->second: heap.min_second();
+        for (I i = b; i!=e; ++i) bound = std::min(bound, i->second);
+
+        batch.clear();
+        for (I i = b; i!=e; ++i) {
+            if (i->first<bound) batch.push_back(*i);
+        }
+
+        if (Sink::enabled) {
+            while (!heap.empty() && heap.top().first>=bound) {
+                feed.evicted(heap.top());
+                heap.pop();
+            }
+            for (auto& p: batch) feed.added(p);
+            heap.insert_batch(batch.begin(), batch.end(), how);
+        }
+        else {
+            heap.insert_batch(batch.begin(), batch.end(), how, bound);
+        }
+    }
+
+    void reserve(std::size_t n) { heap.reserve(n); }
+    void clear() { heap.clear(); }
+
+    using iterator = typename Heap::const_iterator;
     iterator begin() const { return heap.begin(); }
     iterator end() const { return heap.end(); }
 
     std::size_t size() const { return heap.size(); }
 };
 
-// Online algorithm: vector based.
-template <typename T>
+// Online algorithm: vector based. Changes to the minimal set are reported
+// to feed (see changefeed.h).
+template <typename T, typename Sink = null_feed<T>>
 struct min_interval_vector {
     std::vector<interval<T>> items, temp;
+    Sink feed;
 
     void push_back(interval<T> ab) {
-        if (items.empty()) items.push_back(std::move(ab));
+        if (items.empty()) {
+            feed.added(ab);
+            items.push_back(std::move(ab));
+        }
         else {
             temp.clear();
             T min_second = items.front().second;
             for (auto p: items) {
-                if (p.first >= ab.second) continue;
+                if (p.first >= ab.second) {
+                    feed.evicted(p);
+                    continue;
+                }
                 if (p.second < min_second) min_second = p.second;
                 temp.push_back(p);
             }
-            if (ab.first<min_second) temp.push_back(std::move(ab));
+            if (ab.first<min_second) {
+                feed.added(ab);
+                temp.push_back(std::move(ab));
+            }
             std::swap(items, temp);
         }
     }
@@ -57,6 +164,57 @@ struct min_interval_vector {
     std::size_t size() const { return items.size(); }
 };
 
+// Online algorithm: vector based, with left and right hand values in
+// separate arrays, filtered in place by a (SIMD) compaction kernel from
+// soacompact.h in one pass that also finds the minimum kept right hand value.
+template <typename T, typename Kernel = compact_scalar<T>>
+struct min_interval_soa_vector {
+    padded_vector<T> first, second;
+    std::size_t n = 0;
+
+    void push_back(interval<T> ab) {
+        // Kernels may read and write a full vector past the last element.
+        if (first.size()<n+1+Kernel::width) {
+            std::size_t cap = std::max(n+1+Kernel::width, 2*first.size());
+            first.resize(cap);
+            second.resize(cap);
+        }
+
+        T min_second = std::numeric_limits<T>::max();
+        if (n) n = Kernel::compact(n, first.data(), second.data(), ab.second, min_second);
+        if (ab.first<min_second) {
+            first[n] = ab.first;
+            second[n] = ab.second;
+            ++n;
+        }
+    }
+
+    struct iterator {
+        const min_interval_soa_vector* v = nullptr;
+        std::size_t k = 0;
+
+        using value_type = interval<T>;
+        using reference = value_type;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() = default;
+        iterator(const min_interval_soa_vector* v, std::size_t k): v(v), k(k) {}
+
+        iterator& operator++() { ++k; return *this; }
+        iterator operator++(int) { return iterator(v, k++); }
+
+        bool operator==(iterator j) const { return k==j.k; }
+        bool operator!=(iterator j) const { return k!=j.k; }
+
+        reference operator*() const { return {v->first[k], v->second[k]}; }
+    };
+
+    iterator begin() const { return iterator(this, 0); }
+    iterator end() const { return iterator(this, n); }
+
+    std::size_t size() const { return n; }
+};
+
 // Offline algorithm: apply global minimum upper bound.
 template <typename T>
 struct min_interval_offline {
@@ -96,6 +254,62 @@ struct min_interval_offline {
     }
 };
 
+// Sliding window: minimal elements of the intervals currently in the
+// window, where intervals are retired by age or by handle. All intervals in
+// the window are kept, as one that is not minimal may become minimal when
+// older intervals are retired. The minimal elements are then those with
+// left hand value below the window minimum right hand value.
+template <typename T>
+struct min_interval_window {
+    indexed_aug_max_heap<T> heap;
+
+    using handle = typename indexed_aug_max_heap<T>::handle;
+
+    handle push_back(interval<T> ab) { return heap.push_back(std::move(ab)); }
+
+    bool erase(handle h) { return heap.erase(h); }
+    void pop_oldest() { heap.pop_oldest(); }
+    void expire_before(handle h) { heap.erase_before(h); }
+
+    std::size_t window_size() const { return heap.size(); }
+    T min_second() const { return heap.min_second(); }
+
+    template <typename F>
+    void for_each(F f) const {
+        if (heap.empty()) return;
+        T m = heap.min_second();
+        for (auto& el: heap.heap) {
+            if (el.first<m) f(static_cast<const interval<T>&>(el));
+        }
+    }
+
+    std::size_t size() const {
+        std::size_t n = 0;
+        for_each([&n](auto&) { ++n; });
+        return n;
+    }
+};
+
+// Keyed baseline: one min_interval_heap per key.
+template <typename T, typename Key = std::uint64_t>
+struct keyed_min_interval_map {
+    std::unordered_map<Key, min_interval_heap<T>> map;
+
+    void push(Key k, interval<T> ab) { map[k].push_back(std::move(ab)); }
+
+    void push(const Key* k, const interval<T>* ab, std::size_t n) {
+        for (std::size_t i = 0; i<n; ++i) map[k[i]].push_back(ab[i]);
+    }
+
+    std::size_t keys() const { return map.size(); }
+
+    std::size_t size() const {
+        std::size_t n = 0;
+        for (auto& kv: map) n += kv.second.size();
+        return n;
+    }
+};
+
 template <typename Rng>
 std::vector<interval<int>> generate_intervals(unsigned n, unsigned n_overlap, Rng& R) {
     std::vector<interval<int>> ivals;
@@ -130,16 +344,314 @@ void bench_min_interval(benchmark::State& state) {
 
     std::vector<interval<int>> ivals = generate_intervals(n, n_overlap, R);
 
+    std::uint64_t allocs = 0;
     for (auto _: state) {
         state.PauseTiming();
         std::shuffle(ivals.begin(), ivals.end(), R);
         state.ResumeTiming();
 
+        std::uint64_t a0 = allocation_count.load(std::memory_order_relaxed);
         Impl impl;
         for (const auto& i: ivals) impl.push_back(i);
+        allocs += allocation_count.load(std::memory_order_relaxed)-a0;
+
         benchmark::DoNotOptimize(impl.size());
         assert(impl.size()==n_overlap);
     }
+    state.counters["allocs_per_iteration"] = double(allocs)/state.iterations();
+}
+
+// As bench_min_interval, but with one structure reserved for n intervals
+// and cleared between iterations, counting allocations made in the timed
+// loop: the steady state should be allocation free.
+template <typename Impl>
+void bench_min_interval_reuse(benchmark::State& state) {
+    std::minstd_rand R;
+
+    unsigned n = state.range(0);
+    unsigned n_overlap = state.range(1);
+    if (n_overlap<1u) n_overlap = 1u;
+    if (n_overlap>n) n_overlap = n;
+
+    std::vector<interval<int>> ivals = generate_intervals(n, n_overlap, R);
+
+    Impl impl;
+    try {
+        impl.reserve(n);
+    }
+    catch (std::exception& e) {
+        state.SkipWithError(e.what());
+        return;
+    }
+
+    std::uint64_t allocs = 0;
+    for (auto _: state) {
+        state.PauseTiming();
+        std::shuffle(ivals.begin(), ivals.end(), R);
+        impl.clear();
+        state.ResumeTiming();
+
+        std::uint64_t a0 = allocation_count.load(std::memory_order_relaxed);
+        for (const auto& i: ivals) impl.push_back(i);
+        allocs += allocation_count.load(std::memory_order_relaxed)-a0;
+
+        benchmark::DoNotOptimize(impl.size());
+        assert(impl.size()==n_overlap);
+    }
+    state.counters["allocs_per_iteration"] = double(allocs)/state.iterations();
+}
+
+// As bench_min_interval, but with intervals delivered in batches of
+// state.range(2) through push_range.
+template <typename Impl, batch_insert how>
+void bench_min_interval_batch(benchmark::State& state) {
+    std::minstd_rand R;
+
+    unsigned n = state.range(0);
+    unsigned n_overlap = state.range(1);
+    unsigned batch = state.range(2);
+    if (n_overlap<1u) n_overlap = 1u;
+    if (n_overlap>n) n_overlap = n;
+    if (batch<1u) batch = 1u;
+
+    std::vector<interval<int>> ivals = generate_intervals(n, n_overlap, R);
+
+    for (auto _: state) {
+        state.PauseTiming();
+        std::shuffle(ivals.begin(), ivals.end(), R);
+        state.ResumeTiming();
+
+        Impl impl;
+        for (unsigned i = 0; i<n; i += batch) {
+            impl.push_range(ivals.begin()+i, ivals.begin()+std::min(n, i+batch), how);
+        }
+        benchmark::DoNotOptimize(impl.size());
+        assert(impl.size()==n_overlap);
+    }
+}
+
+// As bench_min_interval, but with a delta_ring feed drained after each
+// push into a running checksum, standing in for an incrementally updated
+// downstream index. The replayed deltas are checked against the final set.
+template <typename Impl>
+void bench_min_interval_feed(benchmark::State& state) {
+    std::minstd_rand R;
+
+    unsigned n = state.range(0);
+    unsigned n_overlap = state.range(1);
+    if (n_overlap<1u) n_overlap = 1u;
+    if (n_overlap>n) n_overlap = n;
+
+    std::vector<interval<int>> ivals = generate_intervals(n, n_overlap, R);
+
+    std::uint64_t deltas = 0;
+    for (auto _: state) {
+        state.PauseTiming();
+        std::shuffle(ivals.begin(), ivals.end(), R);
+        state.ResumeTiming();
+
+        Impl impl;
+        long long live = 0, sum = 0;
+        for (const auto& i: ivals) {
+            impl.push_back(i);
+
+            interval_delta<int> d;
+            while (impl.feed.pop(d)) {
+                int sign = d.kind==interval_delta<int>::added? 1: -1;
+                live += sign;
+                sum += sign*(long long)d.value.first;
+                ++deltas;
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+        assert(impl.feed.overrun==0);
+        assert(live==(long long)impl.size());
+#ifndef NDEBUG
+        long long check = 0;
+        for (auto p: impl) check += p.first;
+        assert(sum==check);
+#endif
+    }
+    state.counters["deltas_per_push"] = double(deltas)/(double(state.iterations())*n);
+}
+
+// Keyed tracking: n intervals over state.range(1) keys, with key frequency
+// Zipf distributed with exponent state.range(2)/100 (0 is uniform), pushed
+// in batches of 256. Key values are random 64-bit integers.
+template <typename Impl>
+void bench_keyed_min_interval(benchmark::State& state) {
+    std::minstd_rand R;
+
+    unsigned n = state.range(0);
+    unsigned nkeys = state.range(1);
+    double skew = state.range(2)/100.;
+    if (nkeys<1u) nkeys = 1u;
+
+    std::vector<interval<int>> ivals = generate_intervals(n, 300, R);
+    std::shuffle(ivals.begin(), ivals.end(), R);
+
+    std::vector<std::uint64_t> ids(nkeys);
+    std::mt19937_64 R64;
+    for (auto& id: ids) id = R64();
+
+    std::vector<double> cdf(nkeys);
+    double total = 0;
+    for (unsigned i = 0; i<nkeys; ++i) cdf[i] = total += std::pow(i+1., -skew);
+
+    std::uniform_real_distribution<double> U(0, total);
+    std::vector<std::uint64_t> keys(n);
+    for (auto& k: keys) {
+        auto i = std::lower_bound(cdf.begin(), cdf.end(), U(R))-cdf.begin();
+        k = ids[std::min<std::size_t>(i, nkeys-1)];
+    }
+
+#ifndef NDEBUG
+    keyed_min_interval_map<int> reference;
+    reference.push(keys.data(), ivals.data(), n);
+#endif
+
+    constexpr unsigned batch = 256;
+    std::size_t used_keys = 0;
+    for (auto _: state) {
+        Impl impl;
+        for (unsigned i = 0; i<n; i += batch) {
+            impl.push(keys.data()+i, ivals.data()+i, std::min(batch, n-i));
+        }
+        benchmark::DoNotOptimize(impl.keys());
+        used_keys = impl.keys();
+        assert(impl.keys()==reference.keys());
+        assert(impl.size()==reference.size());
+    }
+    state.SetItemsProcessed(state.iterations()*n);
+    state.counters["keys"] = used_keys;
+}
+
+// Stream n intervals through a window of the most recent w, retiring the
+// oldest interval on each push once the window is full. Arrival order is
+// shuffled within blocks of w intervals.
+template <typename Impl>
+void bench_min_interval_window(benchmark::State& state) {
+    std::minstd_rand R;
+
+    unsigned n = state.range(0);
+    unsigned w = state.range(1);
+    unsigned n_overlap = state.range(2);
+    if (n_overlap<1u) n_overlap = 1u;
+    if (n_overlap>n) n_overlap = n;
+    if (w<1u) w = 1u;
+
+    std::vector<interval<int>> ivals = generate_intervals(n, n_overlap, R);
+    for (unsigned i = 0; i<n; i += w) {
+        std::shuffle(ivals.begin()+i, ivals.begin()+std::min(n, i+w), R);
+    }
+
+    for (auto _: state) {
+        Impl impl;
+        long long sum = 0;
+        for (const auto& i: ivals) {
+            if (impl.window_size()==w) impl.pop_oldest();
+            impl.push_back(i);
+            sum += impl.min_second();
+        }
+        benchmark::DoNotOptimize(sum);
+
+#ifndef NDEBUG
+        int m = ivals[n-1].second;
+        for (unsigned i = n-std::min(n, w); i<n; ++i) m = std::min(m, ivals[i].second);
+        unsigned n_min = 0;
+        for (unsigned i = n-std::min(n, w); i<n; ++i) n_min += ivals[i].first<m;
+        assert(impl.size()==n_min);
+#endif
+    }
+    state.SetItemsProcessed(state.iterations()*n);
+}
+
+// Offline parallel engine over n shuffled intervals with state.range(2)
+// threads, from memory.
+void bench_min_interval_parallel(benchmark::State& state) {
+    std::minstd_rand R;
+
+    unsigned n = state.range(0);
+    unsigned n_overlap = state.range(1);
+    int nthreads = state.range(2);
+    if (n_overlap<1u) n_overlap = 1u;
+    if (n_overlap>n) n_overlap = n;
+
+    std::vector<interval<int>> ivals = generate_intervals(n, n_overlap, R);
+    std::shuffle(ivals.begin(), ivals.end(), R);
+
+    min_interval_parallel<int> engine(nthreads);
+    std::vector<interval<int>> out;
+    for (auto _: state) {
+        engine.run({{ivals.data(), ivals.size()}}, out);
+        benchmark::DoNotOptimize(out.data());
+        assert(out.size()==n_overlap);
+    }
+
+    state.SetItemsProcessed(state.iterations()*n);
+    state.SetBytesProcessed(state.iterations()*n*sizeof(interval<int>));
+    state.counters["items_per_thread"] = benchmark::Counter(double(state.iterations())*n/nthreads, benchmark::Counter::kIsRate);
+}
+
+// As bench_min_interval_parallel, but reading from state.range(3) binary
+// files, memory mapped. Files are written once in setup and are likely to
+// be resident in the page cache: this measures the mapping and page fault
+// overhead, not storage bandwidth.
+void bench_min_interval_mapped(benchmark::State& state) {
+    std::minstd_rand R;
+
+    unsigned n = state.range(0);
+    unsigned n_overlap = state.range(1);
+    int nthreads = state.range(2);
+    unsigned nfiles = state.range(3);
+    if (n_overlap<1u) n_overlap = 1u;
+    if (n_overlap>n) n_overlap = n;
+    if (nfiles<1u) nfiles = 1u;
+
+    std::vector<interval<int>> ivals = generate_intervals(n, n_overlap, R);
+    std::shuffle(ivals.begin(), ivals.end(), R);
+
+    std::vector<std::string> paths;
+    try {
+        const char* tmpdir = std::getenv("TMPDIR");
+        for (unsigned f = 0; f<nfiles; ++f) {
+            std::string path = std::string(tmpdir? tmpdir: "/tmp")+"/min-interval-XXXXXX";
+            int fd = mkstemp(&path[0]);
+            if (fd<0) throw std::system_error(errno, std::generic_category(), "mkstemp");
+            close(fd);
+            paths.push_back(path);
+
+            std::size_t b = std::size_t(n)*f/nfiles, e = std::size_t(n)*(f+1)/nfiles;
+            std::ofstream file(path, std::ios::binary);
+            file.write(reinterpret_cast<const char*>(ivals.data()+b), (e-b)*sizeof(interval<int>));
+            if (!file) throw std::runtime_error("unable to write "+path);
+        }
+        ivals.clear();
+        ivals.shrink_to_fit();
+
+        min_interval_parallel<int> engine(nthreads);
+        std::vector<interval<int>> out;
+        for (auto _: state) {
+            std::vector<mapped_intervals<int>> maps;
+            std::vector<interval_range<int>> inputs;
+            for (auto& path: paths) {
+                maps.emplace_back(path);
+                inputs.push_back(maps.back().range());
+            }
+
+            engine.run(inputs, out);
+            benchmark::DoNotOptimize(out.data());
+            assert(out.size()==n_overlap);
+        }
+    }
+    catch (std::exception& e) {
+        state.SkipWithError(e.what());
+    }
+    for (auto& path: paths) std::remove(path.c_str());
+
+    state.SetItemsProcessed(state.iterations()*n);
+    state.SetBytesProcessed(state.iterations()*n*sizeof(interval<int>));
+    state.counters["items_per_thread"] = benchmark::Counter(double(state.iterations())*n/nthreads, benchmark::Counter::kIsRate);
 }
 
 BENCHMARK_TEMPLATE(bench_min_interval, min_interval_heap<int>)
@@ -175,4 +687,269 @@ BENCHMARK_TEMPLATE(bench_min_interval, min_interval_offline<int>)
     ->Args({10000, 300})
     ->Args({10000, 3000});
 
+// Overhead of the change feed: heap and vector with a ring buffer feed,
+// undrained (overwriting) and drained after each push.
+
+template <typename T>
+using min_interval_heap_feed = min_interval_heap<T, aug_max_heap<T>, delta_ring<T>>;
+
+template <typename T>
+using min_interval_vector_feed = min_interval_vector<T, delta_ring<T>>;
+
+BENCHMARK_TEMPLATE(bench_min_interval, min_interval_heap_feed<int>)
+    ->Args({100, 1})
+    ->Args({100, 3})
+    ->Args({100, 30})
+    ->Args({1000, 1})
+    ->Args({1000, 30})
+    ->Args({1000, 300})
+    ->Args({10000, 1})
+    ->Args({10000, 300})
+    ->Args({10000, 3000});
+
+BENCHMARK_TEMPLATE(bench_min_interval, min_interval_vector_feed<int>)
+    ->Args({100, 1})
+    ->Args({100, 3})
+    ->Args({100, 30})
+    ->Args({1000, 1})
+    ->Args({1000, 30})
+    ->Args({1000, 300})
+    ->Args({10000, 1})
+    ->Args({10000, 300})
+    ->Args({10000, 3000});
+
+BENCHMARK_TEMPLATE(bench_min_interval_feed, min_interval_heap_feed<int>)
+    ->Args({100, 1})
+    ->Args({100, 3})
+    ->Args({100, 30})
+    ->Args({1000, 1})
+    ->Args({1000, 30})
+    ->Args({1000, 300})
+    ->Args({10000, 1})
+    ->Args({10000, 300})
+    ->Args({10000, 3000});
+
+BENCHMARK_TEMPLATE(bench_min_interval_feed, min_interval_vector_feed<int>)
+    ->Args({100, 1})
+    ->Args({100, 3})
+    ->Args({100, 30})
+    ->Args({1000, 1})
+    ->Args({1000, 30})
+    ->Args({1000, 300})
+    ->Args({10000, 1})
+    ->Args({10000, 300})
+    ->Args({10000, 3000});
+
+// Structure of arrays vector with scalar and SIMD compaction.
+
+BENCHMARK_TEMPLATE(bench_min_interval, min_interval_soa_vector<int>)
+    ->Args({100, 1})
+    ->Args({100, 3})
+    ->Args({100, 30})
+    ->Args({1000, 1})
+    ->Args({1000, 30})
+    ->Args({1000, 300})
+    ->Args({10000, 1})
+    ->Args({10000, 300})
+    ->Args({10000, 3000});
+
+#if defined(__AVX2__) && defined(__BMI2__)
+template <typename T>
+using min_interval_soa_vector_avx2 = min_interval_soa_vector<T, compact_avx2>;
+
+BENCHMARK_TEMPLATE(bench_min_interval, min_interval_soa_vector_avx2<int>)
+    ->Args({100, 1})
+    ->Args({100, 3})
+    ->Args({100, 30})
+    ->Args({1000, 1})
+    ->Args({1000, 30})
+    ->Args({1000, 300})
+    ->Args({10000, 1})
+    ->Args({10000, 300})
+    ->Args({10000, 3000});
+#endif
+
+#ifdef __AVX512F__
+template <typename T>
+using min_interval_soa_vector_avx512 = min_interval_soa_vector<T, compact_avx512>;
+
+BENCHMARK_TEMPLATE(bench_min_interval, min_interval_soa_vector_avx512<int>)
+    ->Args({100, 1})
+    ->Args({100, 3})
+    ->Args({100, 30})
+    ->Args({1000, 1})
+    ->Args({1000, 30})
+    ->Args({1000, 300})
+    ->Args({10000, 1})
+    ->Args({10000, 300})
+    ->Args({10000, 3000});
+#endif
+
+// Allocation counts: the default heap against a fresh structure per
+// iteration (bench_min_interval) and reused, and an inline fixed capacity
+// heap reused.
+
+template <typename T>
+using min_interval_heap_inline = min_interval_heap<T, inline_aug_max_heap<T, 10000>>;
+
+BENCHMARK_TEMPLATE(bench_min_interval_reuse, min_interval_heap<int>)
+    ->Args({100, 1})
+    ->Args({100, 3})
+    ->Args({100, 30})
+    ->Args({1000, 1})
+    ->Args({1000, 30})
+    ->Args({1000, 300})
+    ->Args({10000, 1})
+    ->Args({10000, 300})
+    ->Args({10000, 3000});
+
+BENCHMARK_TEMPLATE(bench_min_interval_reuse, min_interval_heap_inline<int>)
+    ->Args({100, 1})
+    ->Args({100, 3})
+    ->Args({100, 30})
+    ->Args({1000, 1})
+    ->Args({1000, 30})
+    ->Args({1000, 300})
+    ->Args({10000, 1})
+    ->Args({10000, 300})
+    ->Args({10000, 3000});
+
+// Binary against 4-ary and 8-ary structure of arrays heaps, at larger sizes.
+
+template <typename T>
+using min_interval_heap4 = min_interval_heap<T, aug_dary_max_heap<T, 4>>;
+
+template <typename T>
+using min_interval_heap8 = min_interval_heap<T, aug_dary_max_heap<T, 8>>;
+
+BENCHMARK_TEMPLATE(bench_min_interval, min_interval_heap<int>)
+    ->Args({100000, 30})
+    ->Args({100000, 3000})
+    ->Args({1000000, 300})
+    ->Args({1000000, 30000})
+    ->Args({10000000, 3000})
+    ->Args({10000000, 300000})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(bench_min_interval, min_interval_heap4<int>)
+    ->Args({100000, 30})
+    ->Args({100000, 3000})
+    ->Args({1000000, 300})
+    ->Args({1000000, 30000})
+    ->Args({10000000, 3000})
+    ->Args({10000000, 300000})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(bench_min_interval, min_interval_heap8<int>)
+    ->Args({100000, 30})
+    ->Args({100000, 3000})
+    ->Args({1000000, 300})
+    ->Args({1000000, 30000})
+    ->Args({10000000, 3000})
+    ->Args({10000000, 300000})
+    ->Unit(benchmark::kMillisecond);
+
+// Bulk insertion by strategy, across batch sizes.
+
+BENCHMARK_TEMPLATE(bench_min_interval_batch, min_interval_heap<int>, batch_insert::sift_up)
+    ->Args({1000000, 300, 16})
+    ->Args({1000000, 300, 256})
+    ->Args({1000000, 300, 4096})
+    ->Args({1000000, 300, 65536})
+    ->Args({1000000, 30000, 16})
+    ->Args({1000000, 30000, 256})
+    ->Args({1000000, 30000, 4096})
+    ->Args({1000000, 30000, 65536})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(bench_min_interval_batch, min_interval_heap<int>, batch_insert::rebuild)
+    ->Args({1000000, 300, 16})
+    ->Args({1000000, 300, 256})
+    ->Args({1000000, 300, 4096})
+    ->Args({1000000, 300, 65536})
+    ->Args({1000000, 30000, 16})
+    ->Args({1000000, 30000, 256})
+    ->Args({1000000, 30000, 4096})
+    ->Args({1000000, 30000, 65536})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(bench_min_interval_batch, min_interval_heap<int>, batch_insert::automatic)
+    ->Args({1000000, 300, 16})
+    ->Args({1000000, 300, 256})
+    ->Args({1000000, 300, 4096})
+    ->Args({1000000, 300, 65536})
+    ->Args({1000000, 30000, 16})
+    ->Args({1000000, 30000, 256})
+    ->Args({1000000, 30000, 4096})
+    ->Args({1000000, 30000, 65536})
+    ->Unit(benchmark::kMillisecond);
+
+// Pooled keyed tracker against a map of heaps, across key cardinality and
+// skew.
+
+template <typename T>
+using keyed_min_interval4 = keyed_min_interval<T, std::uint64_t, 4>;
+
+BENCHMARK_TEMPLATE(bench_keyed_min_interval, keyed_min_interval_map<int>)
+    ->Args({1<<22, 1000, 0})
+    ->Args({1<<22, 1000, 80})
+    ->Args({1<<22, 1000, 120})
+    ->Args({1<<22, 100000, 0})
+    ->Args({1<<22, 100000, 80})
+    ->Args({1<<22, 100000, 120})
+    ->Args({1<<22, 1000000, 0})
+    ->Args({1<<22, 1000000, 80})
+    ->Args({1<<22, 1000000, 120})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(bench_keyed_min_interval, keyed_min_interval4<int>)
+    ->Args({1<<22, 1000, 0})
+    ->Args({1<<22, 1000, 80})
+    ->Args({1<<22, 1000, 120})
+    ->Args({1<<22, 100000, 0})
+    ->Args({1<<22, 100000, 80})
+    ->Args({1<<22, 100000, 120})
+    ->Args({1<<22, 1000000, 0})
+    ->Args({1<<22, 1000000, 80})
+    ->Args({1<<22, 1000000, 120})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(bench_min_interval_window, min_interval_window<int>)
+    ->Args({1<<20, 100, 30})
+    ->Args({1<<20, 1000, 30})
+    ->Args({1<<20, 10000, 300})
+    ->Args({1<<22, 100000, 3000})
+    ->Unit(benchmark::kMillisecond);
+
+// Parallel offline engine: thread counts 1, 2, 4, ... up to the OpenMP
+// maximum, against the serial offline algorithm on the same sizes.
+
+void parallel_args(benchmark::internal::Benchmark* b, std::vector<long> extra) {
+    int max_threads = omp_get_max_threads();
+    for (long n: {1l<<22, 1l<<25}) {
+        for (int t = 1; ; t = std::min(2*t, max_threads)) {
+            std::vector<long> args = {n, 300, t};
+            args.insert(args.end(), extra.begin(), extra.end());
+            b->Args(args);
+            if (t==max_threads) break;
+        }
+    }
+}
+
+BENCHMARK_TEMPLATE(bench_min_interval, min_interval_offline<int>)
+    ->Args({1<<22, 300})
+    ->Args({1<<25, 300})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(bench_min_interval_parallel)
+    ->Apply([](benchmark::internal::Benchmark* b) { parallel_args(b, {}); })
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(bench_min_interval_mapped)
+    ->Apply([](benchmark::internal::Benchmark* b) { parallel_args(b, {1}); })
+    ->Apply([](benchmark::internal::Benchmark* b) { parallel_args(b, {8}); })
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
 BENCHMARK_MAIN();
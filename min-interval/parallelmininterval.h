@@ -0,0 +1,181 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "augmaxheap.h"
+
+// Offline minimal intervals over one or more arrays of intervals, in
+// parallel with OpenMP.
+//
+// The minimal set is the set of intervals with left hand value below the
+// global minimum right hand value. The input is split into chunks, with at
+// most one chunk per thread per array. Each chunk is scanned once as in
+// min_interval_offline, keeping a chunk minimum right hand value and the
+// intervals with left hand value below the running minimum: as the global
+// minimum is no greater, nothing rejected can be minimal. The chunk minima
+// are then reduced, each chunk compacts its candidates against the global
+// minimum, and the survivors are copied to the output at offsets given by
+// a prefix sum, preserving input order.
+
+template <typename T>
+struct interval_range {
+    const interval<T>* data = nullptr;
+    std::size_t size = 0;
+};
+
+// Read-only mapping of a binary file of intervals, each a native endian
+// pair of T.
+template <typename T>
+struct mapped_intervals {
+    explicit mapped_intervals(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd<0) throw std::system_error(errno, std::generic_category(), "open "+path);
+
+        struct stat st;
+        if (fstat(fd, &st)<0) {
+            int err = errno;
+            close(fd);
+            throw std::system_error(err, std::generic_category(), "fstat "+path);
+        }
+
+        bytes_ = st.st_size;
+        if (bytes_%sizeof(interval<T>)) {
+            close(fd);
+            throw std::runtime_error(path+": size is not a multiple of the interval size");
+        }
+
+        if (bytes_) {
+            void* p = mmap(nullptr, bytes_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p==MAP_FAILED) {
+                int err = errno;
+                close(fd);
+                throw std::system_error(err, std::generic_category(), "mmap "+path);
+            }
+            data_ = static_cast<const interval<T>*>(p);
+        }
+        close(fd);
+    }
+
+    mapped_intervals(mapped_intervals&& other): data_(other.data_), bytes_(other.bytes_) {
+        other.data_ = nullptr;
+        other.bytes_ = 0;
+    }
+
+    mapped_intervals(const mapped_intervals&) = delete;
+    mapped_intervals& operator=(const mapped_intervals&) = delete;
+
+    ~mapped_intervals() {
+        if (data_) munmap(const_cast<interval<T>*>(data_), bytes_);
+    }
+
+    const interval<T>* data() const { return data_; }
+    std::size_t size() const { return bytes_/sizeof(interval<T>); }
+
+    interval_range<T> range() const { return {data_, size()}; }
+
+private:
+    const interval<T>* data_ = nullptr;
+    std::size_t bytes_ = 0;
+};
+
+template <typename T>
+struct min_interval_parallel {
+    int nthreads;
+
+    explicit min_interval_parallel(int nthreads = 1): nthreads(std::max(1, nthreads)) {}
+
+    // Minimal intervals of the union of the ranges, in input order.
+    void run(const std::vector<interval_range<T>>& inputs, std::vector<interval<T>>& out) {
+        partition(inputs);
+        int nchunks = nchunks_;
+
+        #pragma omp parallel for num_threads(nthreads) schedule(dynamic, 1)
+        for (int c = 0; c<nchunks; ++c) scan(chunks_[c]);
+
+        T bound = std::numeric_limits<T>::max();
+        for (int c = 0; c<nchunks; ++c) bound = std::min(bound, chunks_[c].upper);
+
+        #pragma omp parallel for num_threads(nthreads) schedule(dynamic, 1)
+        for (int c = 0; c<nchunks; ++c) {
+            auto& cand = chunks_[c].candidates;
+            cand.erase(std::remove_if(cand.begin(), cand.end(),
+                [bound](const interval<T>& p) { return p.first>=bound; }), cand.end());
+        }
+
+        std::size_t total = 0;
+        for (int c = 0; c<nchunks; ++c) {
+            chunks_[c].offset = total;
+            total += chunks_[c].candidates.size();
+        }
+        out.resize(total);
+
+        #pragma omp parallel for num_threads(nthreads) schedule(dynamic, 1)
+        for (int c = 0; c<nchunks; ++c) {
+            auto& cand = chunks_[c].candidates;
+            std::copy(cand.begin(), cand.end(), out.begin()+chunks_[c].offset);
+        }
+    }
+
+    std::vector<interval<T>> operator()(const std::vector<interval_range<T>>& inputs) {
+        std::vector<interval<T>> out;
+        run(inputs, out);
+        return out;
+    }
+
+    std::size_t chunks() const { return nchunks_; }
+
+private:
+    struct chunk {
+        interval_range<T> in;
+        T upper;
+        std::vector<interval<T>> candidates;
+        std::size_t offset;
+    };
+
+    // Chunk buffers are kept between runs: only the first nchunks_ are in
+    // use, and chunks_ never shrinks.
+    std::vector<chunk> chunks_;
+    std::size_t nchunks_ = 0;
+
+    void partition(const std::vector<interval_range<T>>& inputs) {
+        std::size_t total = 0;
+        for (auto& r: inputs) total += r.size;
+        std::size_t grain = std::max<std::size_t>(1, (total+nthreads-1)/nthreads);
+
+        std::size_t nchunks = 0;
+        for (auto& r: inputs) {
+            std::size_t k = (r.size+grain-1)/grain;
+            for (std::size_t i = 0; i<k; ++i) {
+                if (chunks_.size()<=nchunks) chunks_.emplace_back();
+                std::size_t b = r.size*i/k, e = r.size*(i+1)/k;
+                chunks_[nchunks++].in = {r.data+b, e-b};
+            }
+        }
+        nchunks_ = nchunks;
+    }
+
+    static void scan(chunk& c) {
+        const interval<T>* p = c.in.data;
+        std::size_t n = c.in.size;
+
+        T upper = std::numeric_limits<T>::max();
+        c.candidates.clear();
+        for (std::size_t i = 0; i<n; ++i) {
+            if (p[i].second<upper) upper = p[i].second;
+            if (p[i].first<upper) c.candidates.push_back(p[i]);
+        }
+        c.upper = upper;
+    }
+};
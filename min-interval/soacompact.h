@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include <immintrin.h>
+
+// In-place filtering of intervals held as separate arrays of left and
+// right hand values: keep the intervals with first < bound, preserving
+// order, and return the new count and the least right hand value kept
+// (or the greatest value of T if none).
+//
+// The SIMD kernels are for 32-bit int values, and compile only for targets
+// with the instruction set. They read and write whole vectors: the arrays
+// must have room for a full vector past n. As the write position never
+// passes the read position, each vector is loaded before any store can
+// reach it.
+
+template <typename T>
+struct compact_scalar {
+    static std::size_t compact(std::size_t n, T* first, T* second, T bound, T& min_second) {
+        T m = std::numeric_limits<T>::max();
+        std::size_t w = 0;
+        for (std::size_t i = 0; i<n; ++i) {
+            if (first[i]>=bound) continue;
+            if (second[i]<m) m = second[i];
+            first[w] = first[i];
+            second[w] = second[i];
+            ++w;
+        }
+        min_second = m;
+        return w;
+    }
+
+    static constexpr unsigned width = 1;
+};
+
+#if defined(__AVX2__) && defined(__BMI2__)
+// AVX2 has no compress: the permutation that packs the kept lanes is built
+// from the lane mask with pdep/pext, and the full vector is stored.
+struct compact_avx2 {
+    static std::size_t compact(std::size_t n, int* first, int* second, int bound, int& min_second) {
+        const __m256i bound_v = _mm256_set1_epi32(bound);
+        const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        __m256i vmin = _mm256_set1_epi32(std::numeric_limits<int>::max());
+
+        std::size_t w = 0;
+        for (std::size_t i = 0; i<n; i += 8) {
+            __m256i f = _mm256_loadu_si256((const __m256i*)(first+i));
+            __m256i s = _mm256_loadu_si256((const __m256i*)(second+i));
+
+            __m256i keep = _mm256_cmpgt_epi32(bound_v, f);
+            if (n-i<8) keep = _mm256_and_si256(keep, _mm256_cmpgt_epi32(_mm256_set1_epi32(int(n-i)), lane));
+
+            unsigned mask = _mm256_movemask_ps(_mm256_castsi256_ps(keep));
+            vmin = _mm256_min_epi32(vmin, _mm256_blendv_epi8(vmin, s, keep));
+
+            std::uint64_t bytes = _pdep_u64(mask, 0x0101010101010101ull)*0xff;
+            __m256i idx = _mm256_cvtepu8_epi32(_mm_cvtsi64_si128(_pext_u64(0x0706050403020100ull, bytes)));
+
+            _mm256_storeu_si256((__m256i*)(first+w), _mm256_permutevar8x32_epi32(f, idx));
+            _mm256_storeu_si256((__m256i*)(second+w), _mm256_permutevar8x32_epi32(s, idx));
+            w += __builtin_popcount(mask);
+        }
+
+        __m128i m = _mm_min_epi32(_mm256_castsi256_si128(vmin), _mm256_extracti128_si256(vmin, 1));
+        m = _mm_min_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+        m = _mm_min_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+        min_second = _mm_cvtsi128_si32(m);
+        return w;
+    }
+
+    static constexpr unsigned width = 8;
+};
+#endif
+
+#ifdef __AVX512F__
+struct compact_avx512 {
+    static std::size_t compact(std::size_t n, int* first, int* second, int bound, int& min_second) {
+        const __m512i bound_v = _mm512_set1_epi32(bound);
+        __m512i vmin = _mm512_set1_epi32(std::numeric_limits<int>::max());
+
+        std::size_t w = 0;
+        for (std::size_t i = 0; i<n; i += 16) {
+            __mmask16 active = n-i>=16? 0xffff: (1u<<(n-i))-1;
+
+            __m512i f = _mm512_maskz_loadu_epi32(active, first+i);
+            __m512i s = _mm512_maskz_loadu_epi32(active, second+i);
+
+            __mmask16 keep = _mm512_mask_cmplt_epi32_mask(active, f, bound_v);
+            vmin = _mm512_mask_min_epi32(vmin, keep, vmin, s);
+
+            _mm512_mask_compressstoreu_epi32(first+w, keep, f);
+            _mm512_mask_compressstoreu_epi32(second+w, keep, s);
+            w += __builtin_popcount(keep);
+        }
+
+        min_second = _mm512_reduce_min_epi32(vmin);
+        return w;
+    }
+
+    static constexpr unsigned width = 16;
+};
+#endif
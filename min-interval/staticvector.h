@@ -0,0 +1,77 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+
+// Fixed capacity vector with inline storage, with the subset of the
+// std::vector interface used by aug_max_heap. Exceeding the capacity
+// throws std::length_error; nothing is ever allocated.
+
+template <typename X, std::size_t N>
+struct static_vector {
+    using value_type = X;
+    using size_type = std::size_t;
+    using iterator = X*;
+    using const_iterator = const X*;
+
+    static_vector() {}
+
+    template <typename I>
+    static_vector(I b, I e) { insert(end(), b, e); }
+
+    size_type size() const { return n_; }
+    bool empty() const { return !n_; }
+
+    static constexpr size_type capacity() { return N; }
+
+    void reserve(size_type n) {
+        if (n>N) throw std::length_error("static_vector: capacity exceeded");
+    }
+
+    X& operator[](size_type i) { return data_[i]; }
+    const X& operator[](size_type i) const { return data_[i]; }
+
+    X& front() { return data_[0]; }
+    const X& front() const { return data_[0]; }
+    X& back() { return data_[n_-1]; }
+    const X& back() const { return data_[n_-1]; }
+
+    iterator begin() { return data_; }
+    iterator end() { return data_+n_; }
+    const_iterator begin() const { return data_; }
+    const_iterator end() const { return data_+n_; }
+
+    void push_back(const X& x) {
+        reserve(n_+1);
+        data_[n_++] = x;
+    }
+
+    void pop_back() { --n_; }
+
+    void clear() { n_ = 0; }
+
+    // Insertion at the end only.
+    template <typename I>
+    iterator insert(const_iterator pos, I b, I e) {
+        assert(pos==end());
+        size_type k = std::distance(b, e);
+        reserve(n_+k);
+        std::copy(b, e, end());
+        n_ += k;
+        return data_+(pos-data_);
+    }
+
+    // Erasure of a tail only.
+    iterator erase(const_iterator b, const_iterator e) {
+        assert(e==end());
+        n_ = b-data_;
+        return end();
+    }
+
+private:
+    size_type n_ = 0;
+    X data_[N];
+};
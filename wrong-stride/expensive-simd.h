@@ -0,0 +1,228 @@
+#pragma once
+
+// SIMD version of the EXPENSIVE stencil function,
+//
+//     expensive(x) = pow(min(exp(x)-1, 0.2), 1.1),
+//
+// on AVX2 (with FMA) or AVX-512 vectors of doubles, with exp(x)-1
+// computed as expm1(x) and pow(y, 1.1) as exp(1.1·log(y)).
+//
+// exp, expm1: Cody-Waite reduction x = n·ln2 + r, |r| ≤ ln2/2, with a
+// degree 13 Taylor polynomial for exp(r)-1 and the scale by 2^n made in
+// the exponent bits. Inputs are clamped to [-708, 709]. Error ≤ 1 ulp for
+// exp, ≤ 2 ulp for expm1.
+//
+// log: reduction y = m·2^k, m in [√½, √2), and the fdlibm e_log.c
+// polynomial in s = (m-1)/(m+1). Valid for positive normal y (y = expm1(x)
+// is zero or normal for the stencil inputs). Error ≤ 1 ulp.
+//
+// pow(y, 1.1): the absolute error of 1.1·log(y) becomes a relative error
+// of the result, so the bound grows with |log y|. As in the scalar
+// version, y < 0 gives NaN and y = 0 gives 0.
+//
+// expensive: ≤ 4 + 2·|log y| ulp against pow(min(expm1(x), 0.2), 1.1),
+// where y = min(expm1(x), 0.2), while the result is normal (y ≳ 1e-279;
+// below that exp is clamped and the result is not accurate). So ≤ 32 ulp
+// for y ≥ 1e-6 and ≤ 84 ulp for y ≥ 1e-17. (Bounds are from testing
+// against glibc over 10^7 arguments sampled log-uniformly in [1e-280, 1].)
+// The scalar version, with exp(x)-1, loses up to log2(1/|x|) bits to
+// cancellation, so differs from this by more.
+
+#include <immintrin.h>
+
+namespace simd_expensive {
+
+// Vector operations used by the kernels, one struct per instruction set.
+
+#if defined(__AVX2__) && defined(__FMA__)
+struct avx2 {
+    using vec = __m256d;
+    using ivec = __m256i;
+    using mask = __m256d;
+    static constexpr int width = 4;
+
+    static vec set1(double x) { return _mm256_set1_pd(x); }
+    static vec load(const double* p) { return _mm256_loadu_pd(p); }
+    static void store(double* p, vec x) { _mm256_storeu_pd(p, x); }
+
+    static vec add(vec a, vec b) { return _mm256_add_pd(a, b); }
+    static vec sub(vec a, vec b) { return _mm256_sub_pd(a, b); }
+    static vec mul(vec a, vec b) { return _mm256_mul_pd(a, b); }
+    static vec div(vec a, vec b) { return _mm256_div_pd(a, b); }
+    static vec fma(vec a, vec b, vec c) { return _mm256_fmadd_pd(a, b, c); }
+    static vec fnma(vec a, vec b, vec c) { return _mm256_fnmadd_pd(a, b, c); }
+    static vec min(vec a, vec b) { return _mm256_min_pd(a, b); }
+    static vec max(vec a, vec b) { return _mm256_max_pd(a, b); }
+
+    static mask lt(vec a, vec b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+    static mask gt(vec a, vec b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+    static mask eq(vec a, vec b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+    static vec select(mask m, vec a, vec b) { return _mm256_blendv_pd(b, a, m); }
+
+    static ivec bits(vec x) { return _mm256_castpd_si256(x); }
+    static vec from_bits(ivec x) { return _mm256_castsi256_pd(x); }
+    static ivec iset1(long long x) { return _mm256_set1_epi64x(x); }
+    static ivec iadd(ivec a, ivec b) { return _mm256_add_epi64(a, b); }
+    static ivec iand(ivec a, ivec b) { return _mm256_and_si256(a, b); }
+    static ivec ior(ivec a, ivec b) { return _mm256_or_si256(a, b); }
+    static ivec shl(ivec a, int n) { return _mm256_slli_epi64(a, n); }
+    static ivec shr(ivec a, int n) { return _mm256_srli_epi64(a, n); }
+};
+#endif
+
+#if defined(__AVX512F__)
+struct avx512 {
+    using vec = __m512d;
+    using ivec = __m512i;
+    using mask = __mmask8;
+    static constexpr int width = 8;
+
+    static vec set1(double x) { return _mm512_set1_pd(x); }
+    static vec load(const double* p) { return _mm512_loadu_pd(p); }
+    static void store(double* p, vec x) { _mm512_storeu_pd(p, x); }
+
+    static vec add(vec a, vec b) { return _mm512_add_pd(a, b); }
+    static vec sub(vec a, vec b) { return _mm512_sub_pd(a, b); }
+    static vec mul(vec a, vec b) { return _mm512_mul_pd(a, b); }
+    static vec div(vec a, vec b) { return _mm512_div_pd(a, b); }
+    static vec fma(vec a, vec b, vec c) { return _mm512_fmadd_pd(a, b, c); }
+    static vec fnma(vec a, vec b, vec c) { return _mm512_fnmadd_pd(a, b, c); }
+    static vec min(vec a, vec b) { return _mm512_min_pd(a, b); }
+    static vec max(vec a, vec b) { return _mm512_max_pd(a, b); }
+
+    static mask lt(vec a, vec b) { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+    static mask gt(vec a, vec b) { return _mm512_cmp_pd_mask(a, b, _CMP_GT_OQ); }
+    static mask eq(vec a, vec b) { return _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ); }
+    static vec select(mask m, vec a, vec b) { return _mm512_mask_blend_pd(m, b, a); }
+
+    static ivec bits(vec x) { return _mm512_castpd_si512(x); }
+    static vec from_bits(ivec x) { return _mm512_castsi512_pd(x); }
+    static ivec iset1(long long x) { return _mm512_set1_epi64(x); }
+    static ivec iadd(ivec a, ivec b) { return _mm512_add_epi64(a, b); }
+    static ivec iand(ivec a, ivec b) { return _mm512_and_si512(a, b); }
+    static ivec ior(ivec a, ivec b) { return _mm512_or_si512(a, b); }
+    static ivec shl(ivec a, int n) { return _mm512_slli_epi64(a, n); }
+    static ivec shr(ivec a, int n) { return _mm512_srli_epi64(a, n); }
+};
+#endif
+
+constexpr double ln2_hi = 6.93147180369123816490e-01;
+constexpr double ln2_lo = 1.90821492927058770002e-10;
+constexpr double log2e = 1.44269504088896338700e+00;
+
+// Adding 1.5·2^52 rounds to an integer held in the low mantissa bits.
+constexpr double shifter = 0x1.8p52;
+
+// exp(x) as s·(1+q), with s = 2^n and q = exp(r)-1: exp returns s+s·q and
+// expm1 returns (s-1)+s·q, without the cancellation of exp(x)-1 for small x.
+template <typename V>
+void exp_parts(typename V::vec x, typename V::vec& s, typename V::vec& q) {
+    using vec = typename V::vec;
+
+    x = V::max(V::min(x, V::set1(709.)), V::set1(-708.));
+
+    vec t = V::fma(x, V::set1(log2e), V::set1(shifter));
+    vec n = V::sub(t, V::set1(shifter));
+
+    vec r = V::fnma(n, V::set1(ln2_hi), x);
+    r = V::fnma(n, V::set1(ln2_lo), r);
+
+    // 1/k!, k = 13 down to 2.
+    static constexpr double c[] = {
+        1.6059043836821614599e-10, 2.0876756987868098979e-09, 2.5052108385441718775e-08,
+        2.7557319223985890653e-07, 2.7557319223985892511e-06, 2.4801587301587301566e-05,
+        1.9841269841269841253e-04, 1.3888888888888889419e-03, 8.3333333333333332177e-03,
+        4.1666666666666664354e-02, 1.6666666666666665741e-01, 5.0000000000000000000e-01
+    };
+
+    vec p = V::set1(c[0]);
+    for (int k = 1; k<12; ++k) p = V::fma(p, r, V::set1(c[k]));
+    p = V::fma(p, r, V::set1(1.));
+    q = V::mul(p, r);
+
+    // 2^n from the low bits of t.
+    s = V::from_bits(V::shl(V::iadd(V::bits(t), V::iset1(1023)), 52));
+}
+
+template <typename V>
+typename V::vec exp(typename V::vec x) {
+    typename V::vec s, q;
+    exp_parts<V>(x, s, q);
+    return V::fma(s, q, s);
+}
+
+template <typename V>
+typename V::vec expm1(typename V::vec x) {
+    typename V::vec s, q;
+    exp_parts<V>(x, s, q);
+    return V::fma(s, q, V::sub(s, V::set1(1.)));
+}
+
+template <typename V>
+typename V::vec log(typename V::vec y) {
+    using vec = typename V::vec;
+
+    static constexpr double lg[] = {
+        6.666666666666735130e-01, 3.999999999940941908e-01, 2.857142874366239149e-01,
+        2.222219843214978396e-01, 1.818357216161805012e-01, 1.531383769920937332e-01,
+        1.479819860511658591e-01
+    };
+
+    auto b = V::bits(y);
+
+    // Mantissa in [1, 2), exponent as a double via 2^52 + biased exponent.
+    vec m = V::from_bits(V::ior(V::iand(b, V::iset1(0x000fffffffffffffll)), V::iset1(0x3ff0000000000000ll)));
+    vec k = V::sub(V::from_bits(V::ior(V::shr(b, 52), V::iset1(0x4330000000000000ll))), V::set1(0x1p52+1023));
+
+    auto hi = V::gt(m, V::set1(1.41421356237309504880));
+    m = V::select(hi, V::mul(m, V::set1(0.5)), m);
+    k = V::select(hi, V::add(k, V::set1(1.)), k);
+
+    vec f = V::sub(m, V::set1(1.));
+    vec hfsq = V::mul(V::set1(0.5), V::mul(f, f));
+    vec s = V::div(f, V::add(V::set1(2.), f));
+    vec z = V::mul(s, s);
+    vec w = V::mul(z, z);
+
+    vec t1 = V::mul(w, V::fma(w, V::fma(w, V::set1(lg[5]), V::set1(lg[3])), V::set1(lg[1])));
+    vec t2 = V::mul(z, V::fma(w, V::fma(w, V::fma(w, V::set1(lg[6]), V::set1(lg[4])), V::set1(lg[2])), V::set1(lg[0])));
+    vec R = V::add(t2, t1);
+
+    // k·ln2_hi - ((hfsq - (s·(hfsq+R) + k·ln2_lo)) - f)
+    vec u = V::fma(s, V::add(hfsq, R), V::mul(k, V::set1(ln2_lo)));
+    return V::fma(k, V::set1(ln2_hi), V::sub(f, V::sub(hfsq, u)));
+}
+
+template <typename V>
+typename V::vec expensive(typename V::vec x) {
+    using vec = typename V::vec;
+
+    vec y = V::min(expm1<V>(x), V::set1(0.2));
+    vec r = exp<V>(V::mul(V::set1(1.1), log<V>(y)));
+
+    vec zero = V::set1(0.);
+    r = V::select(V::eq(y, zero), zero, r);
+    return V::select(V::lt(y, zero), V::set1(__builtin_nan("")), r);
+}
+
+// One row of the stencil: a[j] += expensive(0.5·(bp[j]-bm[j]) + 0.3·(b0[j+1]-b0[j-1]))
+// for 1 ≤ j < n-1, with the scalar function f for the remainder.
+template <typename V, typename F>
+void stencil_row(int n, double* a, const double* bm, const double* b0, const double* bp, F f) {
+    using vec = typename V::vec;
+
+    int j = 1;
+    for (; j+V::width<=n-1; j += V::width) {
+        vec x = V::fma(V::set1(0.5), V::sub(V::load(bp+j), V::load(bm+j)),
+                       V::mul(V::set1(0.3), V::sub(V::load(b0+j+1), V::load(b0+j-1))));
+#if defined(EXPENSIVE)
+        x = expensive<V>(x);
+#endif
+        V::store(a+j, V::add(V::load(a+j), x));
+    }
+    for (; j<n-1; ++j) {
+        a[j] += f(0.5*(bp[j]-bm[j]) + 0.3*(b0[j+1]-b0[j-1]));
+    }
+}
+
+} // namespace simd_expensive
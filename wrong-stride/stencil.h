@@ -0,0 +1,222 @@
+#pragma once
+
+// Compile-time stencil descriptions and loop nest generation.
+//
+// A stencil is a sum of terms, each a rational coefficient times a signed
+// sum of points, with the point offsets as template arguments:
+//
+//     // 0.5·(b[i+1][j]-b[i-1][j]) + 0.3·(b[i][j+1]-b[i][j-1])
+//     using s = stencil<term<1, 2, at<1, 0>, minus_at<-1, 0>>,
+//                       term<3, 10, at<0, 1>, minus_at<0, -1>>>;
+//
+// Evaluation follows the written order, left to right, so a stencil gives
+// the same result as the equivalent hand-written expression. Grouping
+// points by coefficient keeps the multiplies to one per term.
+//
+// apply_stencil<S, loop_order<...>, Par>(a, b, extent, f) computes
+// a[x] += f(S at x in b) over the interior of extent, with the loops nested
+// in the given order of dimensions (outermost first) and the loop at
+// level Par (0 outermost) split by an OpenMP static schedule, or none for
+// Par = serial_loops. The nest is instantiated per stencil and order, so
+// the point offsets reduce to constant multiples of the block strides.
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <initializer_list>
+#include <string>
+#include <tuple>
+
+// Storage: a Rank-dimensional array of doubles with contiguous last
+// dimension, addressed through the strides of the other dimensions.
+// (For Rank 1, the single stride is unused.)
+template <int Rank>
+struct basic_block {
+    static constexpr int rank = Rank;
+    using extent_type = std::array<int, Rank>;
+
+    double* data = nullptr;
+    std::array<int, (Rank>1? Rank-1: 1)> stride = {};
+
+    // Element stride of dimension d.
+    std::ptrdiff_t step(int d) const { return d<Rank-1? stride[d]: 1; }
+
+    // Row (or plane) i.
+    double* operator[](int i) const { return data+step(0)*i; }
+};
+
+using block = basic_block<2>;
+
+// A point at offset (X...) from the centre, with sign +1 or -1 in its term.
+template <int Sign, int... X>
+struct point {
+    static constexpr int sign = Sign;
+    static constexpr int rank = sizeof...(X);
+
+    static constexpr int at(int d) { return std::array<int, rank>{{X...}}[d]; }
+
+    template <typename B>
+    static std::ptrdiff_t offset(const B& b) {
+        std::ptrdiff_t o = 0;
+        for (int d = 0; d<rank; ++d) o += at(d)*b.step(d);
+        return o;
+    }
+};
+
+template <int... X>
+using at = point<1, X...>;
+
+template <int... X>
+using minus_at = point<-1, X...>;
+
+namespace stencil_impl {
+    constexpr int sum(std::initializer_list<int> xs) {
+        int s = 0;
+        for (int x: xs) s += x;
+        return s;
+    }
+
+    // Left fold of acc ± p[offset] over the points.
+    template <typename... P>
+    struct signed_sum;
+
+    template <>
+    struct signed_sum<> {
+        template <typename B>
+        static double eval(double acc, const double*, const B&) { return acc; }
+    };
+
+    template <typename P, typename... Q>
+    struct signed_sum<P, Q...> {
+        template <typename B>
+        static double eval(double acc, const double* p, const B& b) {
+            double v = p[P::offset(b)];
+            return signed_sum<Q...>::eval(P::sign>0? acc+v: acc-v, p, b);
+        }
+    };
+
+    // Left fold of acc + T(p) over the terms.
+    template <typename... T>
+    struct term_sum;
+
+    template <>
+    struct term_sum<> {
+        template <typename B>
+        static double eval(double acc, const double*, const B&) { return acc; }
+    };
+
+    template <typename T, typename... U>
+    struct term_sum<T, U...> {
+        template <typename B>
+        static double eval(double acc, const double* p, const B& b) {
+            return term_sum<U...>::eval(acc+T::eval(p, b), p, b);
+        }
+    };
+}
+
+// Coefficient Num/Den times the signed sum of the points.
+template <long Num, long Den, typename P, typename... Q>
+struct term {
+    static constexpr double coefficient = double(Num)/double(Den);
+    static constexpr int rank = P::rank;
+    static constexpr int size = 1+sizeof...(Q);
+
+    static_assert(std::min({P::rank, Q::rank...})==std::max({P::rank, Q::rank...}), "points of differing rank");
+
+    // Extent of the term below and above the centre in dimension d.
+    static constexpr int lo(int d) { return std::max({0, -P::at(d), -Q::at(d)...}); }
+    static constexpr int hi(int d) { return std::max({0, P::at(d), Q::at(d)...}); }
+
+    template <typename B>
+    static double eval(const double* p, const B& b) {
+        double v = p[P::offset(b)];
+        return coefficient*stencil_impl::signed_sum<Q...>::eval(P::sign>0? v: -v, p, b);
+    }
+};
+
+template <typename T, typename... U>
+struct stencil {
+    static constexpr int rank = T::rank;
+    static constexpr int size = stencil_impl::sum({T::size, U::size...});
+
+    static_assert(std::min({T::rank, U::rank...})==std::max({T::rank, U::rank...}), "terms of differing rank");
+
+    static constexpr int lo(int d) { return std::max({T::lo(d), U::lo(d)...}); }
+    static constexpr int hi(int d) { return std::max({T::hi(d), U::hi(d)...}); }
+
+    // Value at p, the centre, in storage b.
+    template <typename B>
+    static double eval(const double* p, const B& b) {
+        return stencil_impl::term_sum<U...>::eval(T::eval(p, b), p, b);
+    }
+};
+
+// Loop nest order: dimensions from outermost to innermost.
+template <int... D>
+struct loop_order {
+    static constexpr int rank = sizeof...(D);
+
+    // Dimension letters, e.g. "kij" for loop_order<2, 0, 1>.
+    static std::string name() { return std::string{char('i'+D)...}; }
+};
+
+// All loop orders of rank 1 to 3, as tuples of loop_order.
+template <int Rank>
+struct all_loop_orders;
+
+template <>
+struct all_loop_orders<1> {
+    using type = std::tuple<loop_order<0>>;
+};
+
+template <>
+struct all_loop_orders<2> {
+    using type = std::tuple<loop_order<0, 1>, loop_order<1, 0>>;
+};
+
+template <>
+struct all_loop_orders<3> {
+    using type = std::tuple<
+        loop_order<0, 1, 2>, loop_order<0, 2, 1>, loop_order<1, 0, 2>,
+        loop_order<1, 2, 0>, loop_order<2, 0, 1>, loop_order<2, 1, 0>>;
+};
+
+constexpr int serial_loops = -1;
+
+namespace stencil_impl {
+    template <typename S, int Par, int Level, typename Order>
+    struct nest;
+
+    template <typename S, int Par, int Level>
+    struct nest<S, Par, Level, loop_order<>> {
+        template <typename B, typename F>
+        static void run(B a, B b, const typename B::extent_type&, std::ptrdiff_t oa, std::ptrdiff_t ob, F f) {
+            a.data[oa] += f(S::eval(b.data+ob, b));
+        }
+    };
+
+    template <typename S, int Par, int Level, int D, int... Ds>
+    struct nest<S, Par, Level, loop_order<D, Ds...>> {
+        using inner = nest<S, Par, Level+1, loop_order<Ds...>>;
+
+        template <typename B, typename F>
+        static void run(B a, B b, const typename B::extent_type& extent, std::ptrdiff_t oa, std::ptrdiff_t ob, F f) {
+            int lo = S::lo(D), hi = extent[D]-S::hi(D);
+            std::ptrdiff_t sa = a.step(D), sb = b.step(D);
+
+            if (Level==Par) {
+                #pragma omp parallel for schedule(static)
+                for (int i=lo; i<hi; ++i) inner::run(a, b, extent, oa+i*sa, ob+i*sb, f);
+            }
+            else {
+                for (int i=lo; i<hi; ++i) inner::run(a, b, extent, oa+i*sa, ob+i*sb, f);
+            }
+        }
+    };
+}
+
+template <typename S, typename Order, int Par = serial_loops, int Rank, typename F>
+void apply_stencil(basic_block<Rank> a, basic_block<Rank> b, const typename basic_block<Rank>::extent_type& extent, F f) {
+    static_assert(S::rank==Rank && Order::rank==Rank, "stencil, loop order and block rank differ");
+    stencil_impl::nest<S, Par, 0, Order>::run(a, b, extent, 0, 0, f);
+}
@@ -1,24 +1,41 @@
 #include <algorithm>
+#include <cassert>
+#include <chrono>
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <functional>
 #include <iostream>
+#include <limits>
+#include <map>
 #include <random>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <omp.h>
+#include <pthread.h>
+#include <sched.h>
 
 #include "benchmark/benchmark.h"
 
-constexpr int N = 1000, M = 1000;
+#include "numa-topology.h"
+#include "padded-allocator.h"
+
+#include "expensive-simd.h"
+#include "stencil.h"
 
-struct block {
-    double *data=nullptr;
-    int stride=1;
+constexpr int N = 1000, M = 1000;
 
-    double* operator[](int i) { return data+stride*i; }
+enum {
+    WRONG=0, PARAWRONG=1, SANE=2, PARASANE=3, TILED=4, PARATILED=5,
+    SANE_AVX2=6, PARASANE_AVX2=7, SANE_AVX512=8, PARASANE_AVX512=9
 };
 
-enum { WRONG=0, PARAWRONG=1, SANE=2, PARASANE=3 };
+// Tile extents in rows (i) and columns (j), for TILED and PARATILED.
+struct tile {
+    int i=0, j=0;
+};
 
 #if defined(EXPENSIVE)
 double expensive(double x) {
@@ -30,83 +47,643 @@ double expensive(double x) {
 inline double expensive(double x) { return x; }
 #endif
 
-void run(int which, int M, int N, block a, block b) {
+// The benchmark stencil, a[i][j] += f(0.5·(b[i+1][j]-b[i-1][j]) + 0.3·(b[i][j+1]-b[i][j-1])).
+using wrong_stride_stencil = stencil<
+    term<1, 2, at<1, 0>, minus_at<-1, 0>>,
+    term<3, 10, at<0, 1>, minus_at<0, -1>>>;
+
+struct expensive_fn {
+    double operator()(double x) const { return expensive(x); }
+};
+
+void run(int which, int M, int N, block a, block b, tile t = {}) {
+    using S = wrong_stride_stencil;
+
     switch (which) {
     case WRONG:
-        for (int j=1; j<N-1; ++j) {
-            for (int i=1; i<M-1; ++i) {
-                a[i][j] += expensive(0.5*(b[i+1][j]-b[i-1][j]) + 0.3*(b[i][j+1]-b[i][j-1]));
-            }
-        }
+        apply_stencil<S, loop_order<1, 0>>(a, b, {M, N}, expensive_fn{});
         break;
     case PARAWRONG:
-        for (int j=1; j<N-1; ++j) {
-            #pragma omp parallel for
-            for (int i=1; i<M-1; ++i) {
-                a[i][j] += expensive(0.5*(b[i+1][j]-b[i-1][j]) + 0.3*(b[i][j+1]-b[i][j-1]));
-            }
-        }
+        apply_stencil<S, loop_order<1, 0>, 1>(a, b, {M, N}, expensive_fn{});
         break;
     case SANE:
-        for (int i=1; i<M-1; ++i) {
-            for (int j=1; j<N-1; ++j) {
-                a[i][j] += expensive(0.5*(b[i+1][j]-b[i-1][j]) + 0.3*(b[i][j+1]-b[i][j-1]));
-            }
-        }
+        apply_stencil<S, loop_order<0, 1>>(a, b, {M, N}, expensive_fn{});
         break;
     case PARASANE:
+        // Split over both loops together; apply_stencil splits only one.
         #pragma omp parallel for collapse(2)
         for (int i=1; i<M-1; ++i) {
             for (int j=1; j<N-1; ++j) {
-                a[i][j] += expensive(0.5*(b[i+1][j]-b[i-1][j]) + 0.3*(b[i][j+1]-b[i][j-1]));
+                a[i][j] += expensive(S::eval(b[i]+j, b));
             }
         }
         break;
+    case TILED:
+        for (int ii=1; ii<M-1; ii+=t.i) {
+            for (int jj=1; jj<N-1; jj+=t.j) {
+                int ie = std::min(ii+t.i, M-1), je = std::min(jj+t.j, N-1);
+                for (int i=ii; i<ie; ++i) {
+                    for (int j=jj; j<je; ++j) {
+                        a[i][j] += expensive(S::eval(b[i]+j, b));
+                    }
+                }
+            }
+        }
+        break;
+    case PARATILED:
+        #pragma omp parallel for collapse(2) schedule(static)
+        for (int ii=1; ii<M-1; ii+=t.i) {
+            for (int jj=1; jj<N-1; jj+=t.j) {
+                int ie = std::min(ii+t.i, M-1), je = std::min(jj+t.j, N-1);
+                for (int i=ii; i<ie; ++i) {
+                    for (int j=jj; j<je; ++j) {
+                        a[i][j] += expensive(S::eval(b[i]+j, b));
+                    }
+                }
+            }
+        }
+        break;
+#if defined(__AVX2__) && defined(__FMA__)
+    case SANE_AVX2:
+        for (int i=1; i<M-1; ++i) {
+            simd_expensive::stencil_row<simd_expensive::avx2>(N, a[i], b[i-1], b[i], b[i+1], expensive);
+        }
+        break;
+    case PARASANE_AVX2:
+        #pragma omp parallel for
+        for (int i=1; i<M-1; ++i) {
+            simd_expensive::stencil_row<simd_expensive::avx2>(N, a[i], b[i-1], b[i], b[i+1], expensive);
+        }
+        break;
+#endif
+#if defined(__AVX512F__)
+    case SANE_AVX512:
+        for (int i=1; i<M-1; ++i) {
+            simd_expensive::stencil_row<simd_expensive::avx512>(N, a[i], b[i-1], b[i], b[i+1], expensive);
+        }
+        break;
+    case PARASANE_AVX512:
+        #pragma omp parallel for
+        for (int i=1; i<M-1; ++i) {
+            simd_expensive::stencil_row<simd_expensive::avx512>(N, a[i], b[i-1], b[i], b[i+1], expensive);
+        }
+        break;
+#endif
+    }
+}
+
+// Tile sizes for TILED and PARATILED are tuned on first use for each
+// (dim, thread count) and cached. Each candidate is timed (best of two) on
+// the benchmark grids, over a band of rows bounded to about 2^22 points so
+// that tuning at the largest sizes stays short.
+tile tuned_tile(int which, int dim, block a, block b) {
+    static std::map<std::pair<int, int>, tile> cache;
+
+    int threads = which==PARATILED? omp_get_max_threads(): 1;
+    auto key = std::make_pair(dim, threads);
+    auto it = cache.find(key);
+    if (it!=cache.end()) return it->second;
+
+    int rows = std::min(dim, std::max(258, (1<<22)/dim));
+    int extent = std::max(1, dim-2);
+
+    tile best{extent, extent};
+    double best_time = INFINITY;
+    std::vector<std::pair<int, int>> tried;
+    for (int ti: {4, 16, 64, 256}) {
+        for (int tj: {128, 512, 2048, 8192}) {
+            tile t{std::min(ti, extent), std::min(tj, extent)};
+            auto tk = std::make_pair(t.i, t.j);
+            if (std::find(tried.begin(), tried.end(), tk)!=tried.end()) continue;
+            tried.push_back(tk);
+
+            double time = INFINITY;
+            for (int rep=0; rep<2; ++rep) {
+                auto t0 = std::chrono::steady_clock::now();
+                run(which, rows, dim, a, b, t);
+                std::chrono::duration<double> dt = std::chrono::steady_clock::now()-t0;
+                time = std::min(time, dt.count());
+            }
+            if (time<best_time) {
+                best_time = time;
+                best = t;
+            }
+        }
+    }
+    return cache[key] = best;
+}
+
+bool is_parallel(int which) {
+    return which==PARAWRONG || which==PARASANE || which==PARATILED || which==PARASANE_AVX2 || which==PARASANE_AVX512;
+}
+
+// Page placement and thread pinning.
+//
+// Grids are placed by first touch in initialisation, row by row. With
+// first_touch::match, rows are initialised by a static OpenMP partition for
+// the parallel variants, the row decomposition of all of them, and serially
+// otherwise.
+//
+// Pinning is applied to the OpenMP thread pool for the duration of the
+// benchmark: close fills the CPUs of one node before the next, spread
+// deals threads round robin over the nodes. Binding through OMP_PROC_BIND
+// and OMP_PLACES is fixed at start up, so is applied here with
+// pthread_setaffinity_np instead.
+
+enum class first_touch { match, serial, parallel };
+enum class affinity { none, close, spread };
+
+struct placement {
+    first_touch init = first_touch::match;
+    affinity pin = affinity::none;
+    bool report = false;    // Per-node page and bandwidth counters.
+};
+
+std::string to_string(const placement& pl) {
+    static const char* init[] = {"match", "serial", "parallel"};
+    static const char* pin[] = {"none", "close", "spread"};
+    return std::string("init:")+init[int(pl.init)]+"/bind:"+pin[int(pl.pin)];
+}
+
+// Pin each OpenMP thread according to pin, returning the masks the
+// threads had before, indexed by thread number.
+std::vector<cpu_set_t> apply_affinity(affinity pin) {
+    static const auto nodes = node_cpus();
+
+    std::vector<int> order;
+    if (pin==affinity::close) {
+        for (auto& cpus: nodes) order.insert(order.end(), cpus.begin(), cpus.end());
+    }
+    else if (pin==affinity::spread) {
+        for (std::size_t k = 0; ; ++k) {
+            bool any = false;
+            for (auto& cpus: nodes) {
+                if (k<cpus.size()) {
+                    order.push_back(cpus[k]);
+                    any = true;
+                }
+            }
+            if (!any) break;
+        }
+    }
+
+    std::vector<cpu_set_t> saved(omp_get_max_threads());
+    #pragma omp parallel
+    {
+        cpu_set_t& mine = saved[omp_get_thread_num()];
+        CPU_ZERO(&mine);
+        pthread_getaffinity_np(pthread_self(), sizeof(mine), &mine);
+
+        if (!order.empty()) {
+            cpu_set_t one;
+            CPU_ZERO(&one);
+            CPU_SET(order[omp_get_thread_num()%order.size()], &one);
+            pthread_setaffinity_np(pthread_self(), sizeof(one), &one);
+        }
+    }
+    return saved;
+}
+
+// Undo apply_affinity: each thread gets back its own mask, so that any
+// binding made by the OpenMP runtime (OMP_PROC_BIND, OMP_PLACES) survives.
+void restore_affinity(const std::vector<cpu_set_t>& saved) {
+    #pragma omp parallel
+    {
+        std::size_t t = omp_get_thread_num();
+        if (t<saved.size()) pthread_setaffinity_np(pthread_self(), sizeof(saved[t]), &saved[t]);
+    }
+}
+
+// Grid storage, left uninitialised by the allocation so that pages are
+// placed by the first touch.
+struct grid {
+    padded_allocator<double> alloc;
+    std::size_t n;
+    double* data;
+
+    grid(std::size_t n, memory_policy mp): alloc(mp), n(n), data(alloc.allocate(n)) {}
+    ~grid() { alloc.deallocate(data, n); }
+
+    grid(const grid&) = delete;
+    grid& operator=(const grid&) = delete;
+};
+
+// Zero a and fill b with U(0, 1e-3), with a generator per row so that
+// values do not depend on the initialisation order.
+void init_rows(int dim, int stride, block a, block b, bool parallel) {
+    #pragma omp parallel for schedule(static) if(parallel)
+    for (int i=0; i<dim; ++i) {
+        std::minstd_rand R(i+1);
+        std::uniform_real_distribution<double> U(0,1e-3);
+
+        std::fill(a[i], a[i]+stride, 0.0);
+        for (int j=0; j<stride; ++j) b[i][j] = j<dim? U(R): 0.;
+    }
+}
+
+// One-off check of a SIMD variant against the scalar SANE run, over a
+// band of up to 64 interior rows of b. The vector kernel rounds the
+// stencil input differently (fma), and the scalar expensive() computes
+// exp(x)-1 with an absolute error of about eps, amplified by 1/y in the
+// result; that tolerance is loose, so each point computed by the vector
+// kernel (the row remainder uses the scalar function) is also checked
+// against pow(min(expm1(x), 0.2), 1.1) to the bound of expensive<V> (see
+// expensive-simd.h). Inputs within rounding of zero may change sign, so
+// are not compared.
+void check_simd_variant(int which, int dim, int stride, block b) {
+    int rows = std::min(dim, 66);
+    std::vector<double> ref_(std::size_t(rows)*stride), out_(std::size_t(rows)*stride);
+    block ref{ref_.data(), {stride}};
+    block out{out_.data(), {stride}};
+
+    run(SANE, rows, dim, ref, b);
+    run(which, rows, dim, out, b);
+
+#if defined(EXPENSIVE)
+    int width = which==SANE_AVX512 || which==PARASANE_AVX512? 8: 4;
+    int vec_end = 1+(dim-2)/width*width;
+#endif
+
+    const double eps = std::numeric_limits<double>::epsilon();
+    for (int i=1; i<rows-1; ++i) {
+        for (int j=1; j<dim-1; ++j) {
+            double d1 = 0.5*(b[i+1][j]-b[i-1][j]), d2 = 0.3*(b[i][j+1]-b[i][j-1]);
+            double x = d1+d2, dx = 2*eps*(std::abs(d1)+std::abs(d2));
+            if (std::abs(x)<=dx) continue;
+
+            double r = ref[i][j], v = out[i][j];
+#if defined(EXPENSIVE)
+            double y = std::min(std::expm1(x), 0.2);
+            if (y<0) {
+                assert(std::isnan(r) && std::isnan(v));
+                continue;
+            }
+            double m = std::max(std::abs(r), std::abs(v));
+            assert(std::abs(v-r)<=2*m*1.1*(dx+2*eps)/y);
+            (void)m;
+
+            if (j>=vec_end) continue;
+
+            double e = std::pow(y, 1.1);
+            double tol = 2*e*(1.1*dx/y+(4+2*std::abs(std::log(y)))*eps);
+            assert(std::abs(v-e)<=tol);
+#else
+            double tol = dx;
+            assert(std::abs(v-r)<=tol);
+#endif
+            (void)tol;
+        }
     }
 }
 
-void harness(benchmark::State& state, int dim, int which) {
+// Row padding in doubles: stride = dim+pad. The default is set with
+// --pad=<n> (or 8 when built with -DPAD).
 #ifdef PAD
-    int stride = dim+8;
+int default_pad = 8;
 #else
-    int stride = dim;
+int default_pad = 0;
 #endif
 
-    double* a_ = new double[dim*stride]();
-    double* b_ = new double[dim*stride]();
+// Throughput in bytes/s by pad, for each (which, dim) of the pad sweep.
+std::map<std::pair<int, int>, std::map<int, double>> pad_sweep_rates;
+
+void harness(benchmark::State& state, int dim, int which, memory_policy mp = {}, placement pl = {}, int pad = -1, double* rate = nullptr) {
+    if (pad<0) pad = default_pad;
+    int stride = dim+pad;
+    state.counters["stride"] = stride;
+
+    struct pin_guard {
+        std::vector<cpu_set_t> saved;
+        explicit pin_guard(affinity pin) { if (pin!=affinity::none) saved = apply_affinity(pin); }
+        ~pin_guard() { if (!saved.empty()) restore_affinity(saved); }
+    } guard(pl.pin);
+
+    grid a_(std::size_t(dim)*stride, mp);
+    grid b_(std::size_t(dim)*stride, mp);
+
+    block a{a_.data, {stride}};
+    block b{b_.data, {stride}};
+
+    bool parallel_init = pl.init==first_touch::parallel || (pl.init==first_touch::match && is_parallel(which));
+    init_rows(dim, stride, a, b, parallel_init);
+
+    if (which>=SANE_AVX2 && which<=PARASANE_AVX512) check_simd_variant(which, dim, stride, b);
+
+    tile t;
+    if (which==TILED || which==PARATILED) {
+        t = tuned_tile(which, dim, a, b);
+        state.counters["tile_i"] = t.i;
+        state.counters["tile_j"] = t.j;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (auto _: state) {
+        run(which, dim, dim, a, b, t);
+        benchmark::ClobberMemory();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now()-t0;
+
+    // Minimum traffic per sweep: read b, read and write a.
+    double bytes = 3.*sizeof(double)*(dim-2)*(dim-2)*state.iterations();
+    state.SetBytesProcessed(bytes);
+
+    // The last call is the measured run.
+    if (rate && elapsed.count()>0) *rate = bytes/elapsed.count();
+
+    // Traffic served by each node's memory, by the share of (sampled)
+    // pages of a and b resident there.
+    if (pl.report) {
+        std::size_t bytes_each = sizeof(double)*std::size_t(dim)*stride;
+        std::size_t sample = std::max<std::size_t>(1, bytes_each/sysconf(_SC_PAGESIZE)/4096);
+
+        auto pa = page_nodes(a_.data, bytes_each, sample);
+        auto pb = page_nodes(b_.data, bytes_each, sample);
+        pa.resize(std::max(pa.size(), pb.size()));
+        std::size_t total = 0;
+        for (std::size_t k = 0; k<pb.size(); ++k) pa[k] += pb[k];
+        for (auto c: pa) total += c;
+
+        for (std::size_t k = 0; total && k<pa.size(); ++k) {
+            if (!pa[k]) continue;
+            double share = double(pa[k])/total;
+            state.counters["node"+std::to_string(k)+"_pages"] = share;
+            state.counters["node"+std::to_string(k)+"_bw"] = benchmark::Counter(share*bytes, benchmark::Counter::kIsRate);
+        }
+    }
+}
+
+std::function<void (benchmark::State&)> make_bench(int dim, int which, memory_policy mp = {}, placement pl = {}, int pad = -1) {
+    return [=](benchmark::State& s) {
+        try {
+            harness(s, dim, which, mp, pl, pad);
+        }
+        catch (std::exception& e) {
+            s.SkipWithError(e.what());
+        }
+    };
+}
+
+std::function<void (benchmark::State&)> make_sweep_bench(int dim, int which, int pad) {
+    double* rate = &pad_sweep_rates[{which, dim}][pad];
+    return [=](benchmark::State& s) {
+        try {
+            harness(s, dim, which, {}, {}, pad, rate);
+        }
+        catch (std::exception& e) {
+            s.SkipWithError(e.what());
+        }
+    };
+}
+
+// Pad sweep summary. A stride is flagged as aliased when its throughput is
+// below 80% of the median over all pads for that dim; cache set and TLB
+// conflicts show up at strides with a large power of two factor. The
+// recommended pad is the smallest within 5% of the upper quartile
+// throughput, which is less sensitive to a single noisy run than the best.
+void report_pad_sweep(std::ostream& out) {
+    const char* names[] = {"wrong", "parawrong", "sane", "parasane"};
+
+    for (auto& entry: pad_sweep_rates) {
+        int which = entry.first.first, dim = entry.first.second;
+        const auto& rates = entry.second;
+
+        std::vector<double> sorted;
+        for (auto& pr: rates) if (pr.second>0) sorted.push_back(pr.second);
+        if (sorted.empty()) continue;
+        std::sort(sorted.begin(), sorted.end());
+        double median = sorted[sorted.size()/2], upper = sorted[3*sorted.size()/4];
+
+        int recommend = -1;
+        for (auto& pr: rates) {
+            if (pr.second>=0.95*upper) {
+                recommend = pr.first;
+                break;
+            }
+        }
+
+        out << "#pad-sweep " << names[which] << "/" << dim << ": recommend pad " << recommend
+            << " (stride " << dim+recommend << ")\n";
+
+        for (auto& pr: rates) {
+            if (pr.second<=0 || pr.second>=0.8*median) continue;
+
+            std::size_t bytes = sizeof(double)*(dim+pr.first);
+            std::size_t pow2 = bytes & -bytes;
+            out << "#pad-sweep " << names[which] << "/" << dim << ":   aliasing at pad " << pr.first
+                << " (stride " << dim+pr.first << ", " << bytes << " B, multiple of " << pow2 << " B): "
+                << int(100*pr.second/median) << "% of median\n";
+        }
+    }
+}
+
+// Stencils on 1-, 2- and 3-d blocks, benchmarked in every loop order.
+// Second order Laplacians scaled by h², except for the fourth order 1-d.
+
+using laplace1d_5pt = stencil<
+    term<-1, 12, at<-2>, at<2>>,
+    term<16, 12, at<-1>, at<1>>,
+    term<-30, 12, at<0>>>;
 
-    block a{a_, stride};
-    block b{b_, stride};
+using laplace2d_5pt = stencil<
+    term<1, 1, at<-1, 0>, at<1, 0>, at<0, -1>, at<0, 1>>,
+    term<-4, 1, at<0, 0>>>;
+
+using laplace2d_9pt = stencil<
+    term<4, 6, at<-1, 0>, at<1, 0>, at<0, -1>, at<0, 1>>,
+    term<1, 6, at<-1, -1>, at<-1, 1>, at<1, -1>, at<1, 1>>,
+    term<-20, 6, at<0, 0>>>;
+
+using laplace3d_27pt = stencil<
+    term<14, 30,
+        at<-1, 0, 0>, at<1, 0, 0>, at<0, -1, 0>, at<0, 1, 0>, at<0, 0, -1>, at<0, 0, 1>>,
+    term<3, 30,
+        at<-1, -1, 0>, at<-1, 1, 0>, at<1, -1, 0>, at<1, 1, 0>,
+        at<-1, 0, -1>, at<-1, 0, 1>, at<1, 0, -1>, at<1, 0, 1>,
+        at<0, -1, -1>, at<0, -1, 1>, at<0, 1, -1>, at<0, 1, 1>>,
+    term<1, 30,
+        at<-1, -1, -1>, at<-1, -1, 1>, at<-1, 1, -1>, at<-1, 1, 1>,
+        at<1, -1, -1>, at<1, -1, 1>, at<1, 1, -1>, at<1, 1, 1>>,
+    term<-128, 30, at<0, 0, 0>>>;
+
+// a += f(S(b)) over the interior of extent, with the last dimension padded
+// by default_pad.
+template <typename S, typename Order, int Par>
+void stencil_harness(benchmark::State& state, std::array<int, S::rank> extent) {
+    constexpr int rank = S::rank;
+
+    basic_block<rank> a, b;
+    std::size_t n = extent[rank-1]+default_pad;
+    for (int d = rank-2; d>=0; --d) {
+        a.stride[d] = b.stride[d] = n;
+        n *= extent[d];
+    }
+
+    grid a_(n, {});
+    grid b_(n, {});
+    a.data = a_.data;
+    b.data = b_.data;
 
     std::minstd_rand R;
     std::uniform_real_distribution<double> U(0,1e-3);
-
-    std::fill(&a[0][0], &a[0][0]+dim*dim, 0.0);
-    for (int i=0; i<dim; ++i)
-        for (int j=0; j<dim; ++j)
-            b[i][j] = U(R);
+    std::fill(a.data, a.data+n, 0.0);
+    std::generate(b.data, b.data+n, [&] { return U(R); });
 
     for (auto _: state) {
-        run(which, dim, dim, a, b);
+        apply_stencil<S, Order, Par>(a, b, extent, expensive_fn{});
         benchmark::ClobberMemory();
     }
 
-    delete[] a_;
-    delete[] b_;
+    double points = 1;
+    for (int d = 0; d<rank; ++d) points *= extent[d]-S::lo(d)-S::hi(d);
+    state.SetItemsProcessed(points*state.iterations());
+    state.SetBytesProcessed(3.*sizeof(double)*points*state.iterations());
+    state.counters["stencil_points"] = S::size;
 }
 
-std::function<void (benchmark::State&)> make_bench(int dim, int which) {
-    return [=](benchmark::State& s) { harness(s, dim, which); };
+template <typename S, typename Order, int Par>
+void register_stencil_order(const std::string& name, const std::array<int, S::rank>& extent) {
+    std::string label = std::string(Par==serial_loops? "stencil/": "parastencil/")+name+"/"+Order::name()+"/";
+    for (int d = 0; d<S::rank; ++d) label += (d? "x": "")+std::to_string(extent[d]);
+
+    benchmark::RegisterBenchmark(label.c_str(),
+        [extent](benchmark::State& s) {
+            try {
+                stencil_harness<S, Order, Par>(s, extent);
+            }
+            catch (std::exception& e) {
+                s.SkipWithError(e.what());
+            }
+        })->UseRealTime();
 }
 
+template <typename S, typename Orders = typename all_loop_orders<S::rank>::type>
+struct register_stencil;
+
+template <typename S, typename... Orders>
+struct register_stencil<S, std::tuple<Orders...>> {
+    // Serial, and parallel over the outermost loop, in each order.
+    static void apply(const std::string& name, const std::array<int, S::rank>& extent) {
+        int expand[] = {(register_stencil_order<S, Orders, serial_loops>(name, extent), 0)...};
+        int para_expand[] = {(register_stencil_order<S, Orders, 0>(name, extent), 0)...};
+        (void)expand;
+        (void)para_expand;
+    }
+};
+
 int main(int argc, char** argv) {
+    // Local options, removed before benchmark::Initialize:
+    //   --pad=<n>      row padding in doubles for all benchmarks;
+    //   --pad-sweep    register only the pad sweep, pad 0..64 for WRONG and
+    //                  SANE, and summarise it after the run.
+    bool pad_sweep = false;
+    {
+        int k = 1;
+        for (int i = 1; i<argc; ++i) {
+            if (!std::strncmp(argv[i], "--pad=", 6)) default_pad = std::max(0, std::atoi(argv[i]+6));
+            else if (!std::strcmp(argv[i], "--pad-sweep")) pad_sweep = true;
+            else argv[k++] = argv[i];
+        }
+        argc = k;
+    }
+
+    if (pad_sweep) {
+        // Dims both side of powers of two.
+        for (int dim: {200, 256, 400, 512, 800, 1024, 1600, 2048}) {
+            for (int which: {WRONG, SANE}) {
+                const char* name = which==WRONG? "wrong": "sane";
+                for (int pad = 0; pad<=64; ++pad) {
+                    std::string label = std::string("sweep/")+name+"/"+std::to_string(dim)+"/pad:"+std::to_string(pad);
+                    benchmark::RegisterBenchmark(label.c_str(), make_sweep_bench(dim, which, pad))->UseRealTime();
+                }
+            }
+        }
+
+        benchmark::Initialize(&argc, argv);
+        benchmark::RunSpecifiedBenchmarks();
+        report_pad_sweep(std::cout);
+        return 0;
+    }
+
     std::cout << "#thread: " << omp_get_max_threads() << "\n";
+    std::cout << "#numa-node: " << node_cpus().size() << "\n";
     for (int dim: {50, 100, 200, 400, 800, 1600}) {
         benchmark::RegisterBenchmark(("wrong/"+std::to_string(dim)).c_str(), make_bench(dim, WRONG))->UseRealTime();
         benchmark::RegisterBenchmark(("parawrong/"+std::to_string(dim)).c_str(), make_bench(dim, PARAWRONG))->UseRealTime();
         benchmark::RegisterBenchmark(("sane/"+std::to_string(dim)).c_str(), make_bench(dim, SANE))->UseRealTime();
         benchmark::RegisterBenchmark(("parasane/"+std::to_string(dim)).c_str(), make_bench(dim, PARASANE))->UseRealTime();
+        benchmark::RegisterBenchmark(("tiled/"+std::to_string(dim)).c_str(), make_bench(dim, TILED))->UseRealTime();
+        benchmark::RegisterBenchmark(("paratiled/"+std::to_string(dim)).c_str(), make_bench(dim, PARATILED))->UseRealTime();
     }
+
+    // SANE and PARASANE with the stencil function vectorised over rows.
+    struct simd_variant {
+        const char* name;
+        int which;
+    };
+    std::vector<simd_variant> simd_variants;
+#if defined(__AVX2__) && defined(__FMA__)
+    simd_variants.push_back({"sane_avx2", SANE_AVX2});
+    simd_variants.push_back({"parasane_avx2", PARASANE_AVX2});
+#endif
+#if defined(__AVX512F__)
+    simd_variants.push_back({"sane_avx512", SANE_AVX512});
+    simd_variants.push_back({"parasane_avx512", PARASANE_AVX512});
+#endif
+    for (int dim: {50, 100, 200, 400, 800, 1600, 3200, 6400, 16000}) {
+        for (auto& v: simd_variants) {
+            benchmark::RegisterBenchmark((std::string(v.name)+"/"+std::to_string(dim)).c_str(), make_bench(dim, v.which))->UseRealTime();
+        }
+    }
+
+    // Beyond L2 reach of three rows of b: untiled against tiled only.
+    for (int dim: {3200, 6400, 16000}) {
+        benchmark::RegisterBenchmark(("sane/"+std::to_string(dim)).c_str(), make_bench(dim, SANE))->UseRealTime();
+        benchmark::RegisterBenchmark(("parasane/"+std::to_string(dim)).c_str(), make_bench(dim, PARASANE))->UseRealTime();
+        benchmark::RegisterBenchmark(("tiled/"+std::to_string(dim)).c_str(), make_bench(dim, TILED))->UseRealTime();
+        benchmark::RegisterBenchmark(("paratiled/"+std::to_string(dim)).c_str(), make_bench(dim, PARATILED))->UseRealTime();
+    }
+
+    // Huge page and NUMA placement of the grids at sizes beyond TLB reach.
+    memory_policy policies[] = {
+        {},
+        {page_kind::transparent_huge},
+        {page_kind::explicit_huge},
+        {page_kind::normal, numa_placement::interleave},
+        {page_kind::transparent_huge, numa_placement::interleave}
+    };
+
+    for (int dim: {1600, 6400}) {
+        for (auto& mp: policies) {
+            std::string suffix = "/"+std::to_string(dim)+"/alloc:"+to_string(mp);
+            benchmark::RegisterBenchmark(("sane"+suffix).c_str(), make_bench(dim, SANE, mp))->UseRealTime();
+            benchmark::RegisterBenchmark(("parasane"+suffix).c_str(), make_bench(dim, PARASANE, mp))->UseRealTime();
+        }
+    }
+
+    // First touch and pinning of the parallel variants, with per-node
+    // page placement and bandwidth.
+    for (int dim: {1600, 6400}) {
+        for (auto init: {first_touch::serial, first_touch::parallel}) {
+            for (auto pin: {affinity::none, affinity::close, affinity::spread}) {
+                placement pl{init, pin, true};
+                std::string suffix = "/"+std::to_string(dim)+"/"+to_string(pl);
+                benchmark::RegisterBenchmark(("parasane"+suffix).c_str(), make_bench(dim, PARASANE, {}, pl))->UseRealTime();
+                benchmark::RegisterBenchmark(("paratiled"+suffix).c_str(), make_bench(dim, PARATILED, {}, pl))->UseRealTime();
+            }
+        }
+    }
+
+    for (int n: {1<<16, 1<<20, 1<<24}) {
+        register_stencil<laplace1d_5pt>::apply("laplace1d_5pt", {n});
+    }
+    for (int dim: {400, 1600, 4000}) {
+        register_stencil<laplace2d_5pt>::apply("laplace2d_5pt", {dim, dim});
+        register_stencil<laplace2d_9pt>::apply("laplace2d_9pt", {dim, dim});
+    }
+    for (int dim: {32, 100, 256}) {
+        register_stencil<laplace3d_27pt>::apply("laplace3d_27pt", {dim, dim, dim});
+    }
+
     benchmark::Initialize(&argc, argv);
     benchmark::RunSpecifiedBenchmarks();
 }